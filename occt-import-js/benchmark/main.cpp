@@ -0,0 +1,149 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "generator.hpp"
+#include "importer-step.hpp"
+#include "importer-brep.hpp"
+#include "importer-result.hpp"
+#include "importer-utils.hpp"
+
+class BenchmarkCase
+{
+public:
+    BenchmarkCase (const std::string& name, int partCount, int instanceCount, int depth, int facesPerPart, int colorCount) :
+        name (name),
+        params ()
+    {
+        params.partCount = partCount;
+        params.instanceCount = instanceCount;
+        params.depth = depth;
+        params.facesPerPart = facesPerPart;
+        params.colorCount = colorCount;
+    }
+
+    std::string name;
+    GeneratorParams params;
+};
+
+class BenchmarkResult
+{
+public:
+    BenchmarkResult () :
+        success (false),
+        loadTime (0.0),
+        extractTime (0.0),
+        meshCount (0),
+        triangleCount (0)
+    {
+
+    }
+
+    bool success;
+    double loadTime;
+    double extractTime;
+    size_t meshCount;
+    size_t triangleCount;
+};
+
+static double GetElapsedMilliseconds (const std::chrono::steady_clock::time_point& start)
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now () - start;
+    return elapsed.count ();
+}
+
+static BenchmarkResult RunImport (const std::string& filePath, GeneratorParams::Format format)
+{
+    BenchmarkResult result;
+    ImporterPtr importer;
+    if (format == GeneratorParams::Format::Step) {
+        importer = std::make_shared<ImporterStep> ();
+    } else {
+        importer = std::make_shared<ImporterBrep> ();
+    }
+
+    ImportParams params;
+    std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now ();
+    if (importer->LoadFile (filePath, params) != Importer::Result::Success) {
+        return result;
+    }
+    result.loadTime = GetElapsedMilliseconds (loadStart);
+
+    ImportResult importResult;
+    std::chrono::steady_clock::time_point extractStart = std::chrono::steady_clock::now ();
+    ExtractResult (importer->GetRootNode (), params, importResult);
+    result.extractTime = GetElapsedMilliseconds (extractStart);
+
+    result.success = true;
+    result.meshCount = importResult.meshes.size ();
+    for (const ResultMesh& mesh : importResult.meshes) {
+        result.triangleCount += mesh.indices.size () / 3;
+    }
+    ReleaseImporter (importer);
+    return result;
+}
+
+int main (int argc, const char* argv[])
+{
+    if (argc < 2) {
+        std::cout << "Usage: OcctImportJSBenchmark <work folder>" << std::endl;
+        return 1;
+    }
+
+    std::string folder = argv[1];
+
+    // every parameter is swept separately, the others keep a small default value
+    std::vector<BenchmarkCase> cases = {
+        BenchmarkCase ("parts", 10, 1, 1, 6, 0),
+        BenchmarkCase ("parts", 100, 1, 1, 6, 0),
+        BenchmarkCase ("parts", 1000, 1, 1, 6, 0),
+        BenchmarkCase ("instances", 100, 10, 1, 6, 0),
+        BenchmarkCase ("instances", 100, 50, 1, 6, 0),
+        BenchmarkCase ("depth", 10, 1, 4, 6, 0),
+        BenchmarkCase ("depth", 10, 1, 8, 6, 0),
+        BenchmarkCase ("depth", 10, 1, 12, 6, 0),
+        BenchmarkCase ("faces", 100, 1, 1, 34, 0),
+        BenchmarkCase ("faces", 100, 1, 1, 130, 0),
+        BenchmarkCase ("colors", 1000, 1, 1, 6, 16),
+        BenchmarkCase ("colors", 1000, 1, 1, 6, 1000)
+    };
+
+    // the load time of step files contains parsing and transfer, the extract time contains triangulation,
+    // the load time of brep files contains parsing and triangulation
+    std::cout << std::left;
+    std::cout << std::setw (10) << "case" << std::setw (6) << "format" << std::setw (8) << "parts" << std::setw (10) << "instances";
+    std::cout << std::setw (6) << "depth" << std::setw (6) << "faces" << std::setw (7) << "colors";
+    std::cout << std::setw (10) << "load ms" << std::setw (12) << "extract ms" << std::setw (8) << "meshes" << "triangles" << std::endl;
+
+    int errorCount = 0;
+    for (BenchmarkCase& benchmarkCase : cases) {
+        for (GeneratorParams::Format format : { GeneratorParams::Format::Step, GeneratorParams::Format::Brep }) {
+            bool isStep = (format == GeneratorParams::Format::Step);
+            benchmarkCase.params.format = format;
+            std::string filePath = folder + "/benchmark" + (isStep ? ".step" : ".brep");
+            if (!GenerateFile (filePath, benchmarkCase.params)) {
+                std::cout << "Failed to generate " << filePath << std::endl;
+                errorCount += 1;
+                continue;
+            }
+
+            BenchmarkResult result = RunImport (filePath, format);
+            if (!result.success) {
+                std::cout << "Failed to import " << filePath << std::endl;
+                errorCount += 1;
+                continue;
+            }
+
+            const GeneratorParams& params = benchmarkCase.params;
+            std::cout << std::setw (10) << benchmarkCase.name << std::setw (6) << (isStep ? "step" : "brep");
+            std::cout << std::setw (8) << params.partCount << std::setw (10) << params.GetInstanceCount ();
+            std::cout << std::setw (6) << params.depth << std::setw (6) << params.facesPerPart << std::setw (7) << params.colorCount;
+            std::cout << std::setw (10) << (int) result.loadTime << std::setw (12) << (int) result.extractTime;
+            std::cout << std::setw (8) << result.meshCount << result.triangleCount << std::endl;
+        }
+    }
+
+    return errorCount == 0 ? 0 : 1;
+}
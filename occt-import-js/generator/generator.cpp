@@ -0,0 +1,131 @@
+#include "generator.hpp"
+
+#include <TDocStd_Document.hxx>
+#include <TDataStd_Name.hxx>
+#include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_ShapeTool.hxx>
+#include <XCAFDoc_ColorTool.hxx>
+#include <STEPCAFControl_Writer.hxx>
+#include <BRepBuilderAPI_MakePolygon.hxx>
+#include <BRepBuilderAPI_MakeFace.hxx>
+#include <BRepPrimAPI_MakePrism.hxx>
+#include <BRepTools.hxx>
+#include <Quantity_Color.hxx>
+#include <TopLoc_Location.hxx>
+#include <gp_Trsf.hxx>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static const double Pi = 3.14159265358979323846;
+static const double PartSpacing = 3.0;
+
+static TopoDS_Shape CreatePart (int partIndex, int sideCount)
+{
+    // prism over a regular polygon, every part has a slightly different size,
+    // so they are different shapes in the file
+    double radius = 1.0 + 0.001 * partIndex;
+    BRepBuilderAPI_MakePolygon polygon;
+    for (int sideIndex = 0; sideIndex < sideCount; sideIndex++) {
+        double angle = 2.0 * Pi * sideIndex / sideCount;
+        polygon.Add (gp_Pnt (radius * std::cos (angle), radius * std::sin (angle), 0.0));
+    }
+    polygon.Close ();
+
+    BRepBuilderAPI_MakeFace face (polygon.Wire ());
+    BRepPrimAPI_MakePrism prism (face.Face (), gp_Vec (0.0, 0.0, radius));
+    return prism.Shape ();
+}
+
+static void SetName (const TDF_Label& label, const std::string& name)
+{
+    TDataStd_Name::Set (label, TCollection_ExtendedString (name.c_str ()));
+}
+
+static TopLoc_Location GetTranslation (double x, double y)
+{
+    gp_Trsf transformation;
+    transformation.SetTranslation (gp_Vec (x, y, 0.0));
+    return TopLoc_Location (transformation);
+}
+
+GeneratorParams::GeneratorParams () :
+    format (Format::Step),
+    partCount (10),
+    instanceCount (1),
+    depth (1),
+    facesPerPart (6),
+    colorCount (0)
+{
+
+}
+
+int GeneratorParams::GetInstanceCount () const
+{
+    // every assembly level contains two instances of the next level
+    return partCount * instanceCount * (1 << (depth - 1));
+}
+
+bool GenerateFile (const std::string& filePath, const GeneratorParams& params)
+{
+    if (params.partCount < 1 || params.instanceCount < 1 || params.depth < 1 || params.depth > 20) {
+        return false;
+    }
+
+    Handle (TDocStd_Document) document = new TDocStd_Document ("XmlXCAF");
+    Handle (XCAFDoc_ShapeTool) shapeTool = XCAFDoc_DocumentTool::ShapeTool (document->Main ());
+    Handle (XCAFDoc_ColorTool) colorTool = XCAFDoc_DocumentTool::ColorTool (document->Main ());
+
+    int sideCount = std::max (params.facesPerPart - 2, 3);
+    std::vector<TDF_Label> partLabels;
+    for (int partIndex = 0; partIndex < params.partCount; partIndex++) {
+        TDF_Label partLabel = shapeTool->AddShape (CreatePart (partIndex, sideCount), Standard_False);
+        SetName (partLabel, "Part " + std::to_string (partIndex + 1));
+        if (params.colorCount > 0) {
+            double hue = 360.0 * (partIndex % params.colorCount) / params.colorCount;
+            colorTool->SetColor (partLabel, Quantity_Color (hue, 0.5, 1.0, Quantity_TOC_HLS), XCAFDoc_ColorSurf);
+        }
+        partLabels.push_back (partLabel);
+    }
+
+    // the leaf assembly contains the instances of the parts in a grid
+    int leafItemCount = params.partCount * params.instanceCount;
+    int columnCount = (int) std::ceil (std::sqrt ((double) leafItemCount));
+    TDF_Label assemblyLabel = shapeTool->NewShape ();
+    SetName (assemblyLabel, "Assembly " + std::to_string (params.depth));
+    for (int itemIndex = 0; itemIndex < leafItemCount; itemIndex++) {
+        const TDF_Label& partLabel = partLabels[itemIndex % params.partCount];
+        TopLoc_Location location = GetTranslation (PartSpacing * (itemIndex % columnCount), PartSpacing * (itemIndex / columnCount));
+        shapeTool->AddComponent (assemblyLabel, partLabel, location);
+    }
+
+    // every other level contains two instances of the next level side by side
+    double assemblySize = PartSpacing * columnCount;
+    for (int level = params.depth - 1; level >= 1; level--) {
+        TDF_Label parentLabel = shapeTool->NewShape ();
+        SetName (parentLabel, "Assembly " + std::to_string (level));
+        bool horizontal = (level % 2 == 0);
+        for (int copyIndex = 0; copyIndex < 2; copyIndex++) {
+            double offset = copyIndex * assemblySize;
+            TopLoc_Location location = horizontal ? GetTranslation (offset, 0.0) : GetTranslation (0.0, offset);
+            shapeTool->AddComponent (parentLabel, assemblyLabel, location);
+        }
+        assemblyLabel = parentLabel;
+        assemblySize *= 2.0;
+    }
+    shapeTool->UpdateAssemblies ();
+
+    if (params.format == GeneratorParams::Format::Brep) {
+        TopoDS_Shape shape = shapeTool->GetShape (assemblyLabel);
+        return BRepTools::Write (shape, filePath.c_str ());
+    }
+
+    STEPCAFControl_Writer writer;
+    writer.SetColorMode (true);
+    writer.SetNameMode (true);
+    if (!writer.Transfer (document, STEPControl_AsIs)) {
+        return false;
+    }
+    return writer.Write (filePath.c_str ()) == IFSelect_RetDone;
+}
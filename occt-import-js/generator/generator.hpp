@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+class GeneratorParams
+{
+public:
+    enum class Format
+    {
+        Step,
+        Brep
+    };
+
+    GeneratorParams ();
+
+    int GetInstanceCount () const;
+
+    Format format;
+    int partCount;
+    int instanceCount;
+    int depth;
+    int facesPerPart;
+    int colorCount;
+};
+
+bool GenerateFile (const std::string& filePath, const GeneratorParams& params);
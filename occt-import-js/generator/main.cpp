@@ -0,0 +1,34 @@
+#include <iostream>
+#include <string>
+
+#include "generator.hpp"
+
+static bool EndsWith (const std::string& str, const std::string& end)
+{
+    return str.size () >= end.size () && str.compare (str.size () - end.size (), end.size (), end) == 0;
+}
+
+int main (int argc, const char* argv[])
+{
+    if (argc < 2) {
+        std::cout << "Usage: OcctImportJSGenerator <output file (.step or .brep)> [parts] [instances] [depth] [faces per part] [colors]" << std::endl;
+        return 1;
+    }
+
+    std::string filePath = argv[1];
+    GeneratorParams params;
+    params.format = (EndsWith (filePath, ".brep") ? GeneratorParams::Format::Brep : GeneratorParams::Format::Step);
+    params.partCount = (argc > 2 ? std::stoi (argv[2]) : params.partCount);
+    params.instanceCount = (argc > 3 ? std::stoi (argv[3]) : params.instanceCount);
+    params.depth = (argc > 4 ? std::stoi (argv[4]) : params.depth);
+    params.facesPerPart = (argc > 5 ? std::stoi (argv[5]) : params.facesPerPart);
+    params.colorCount = (argc > 6 ? std::stoi (argv[6]) : params.colorCount);
+
+    if (!GenerateFile (filePath, params)) {
+        std::cout << "Failed to generate " << filePath << std::endl;
+        return 1;
+    }
+
+    std::cout << filePath << ": " << params.partCount << " parts, " << params.GetInstanceCount () << " instances" << std::endl;
+    return 0;
+}
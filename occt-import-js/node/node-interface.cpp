@@ -0,0 +1,609 @@
+#include "importer-step.hpp"
+#include "importer-iges.hpp"
+#include "importer-brep.hpp"
+#include "importer-result.hpp"
+#include "importer-utils.hpp"
+#include "importer-cache.hpp"
+#include "importer-reuse.hpp"
+#include "importer-trace.hpp"
+
+#include <node_api.h>
+
+#include <Standard_Failure.hxx>
+
+#include <cstring>
+#include <exception>
+
+static bool IsPropertySet (napi_env env, napi_value object, const char* name, napi_value& value)
+{
+    bool hasProperty = false;
+    if (napi_has_named_property (env, object, name, &hasProperty) != napi_ok || !hasProperty) {
+        return false;
+    }
+    if (napi_get_named_property (env, object, name, &value) != napi_ok) {
+        return false;
+    }
+    napi_valuetype valueType = napi_undefined;
+    napi_typeof (env, value, &valueType);
+    return valueType != napi_undefined && valueType != napi_null;
+}
+
+static bool GetString (napi_env env, napi_value value, std::string& result)
+{
+    size_t length = 0;
+    if (napi_get_value_string_utf8 (env, value, nullptr, 0, &length) != napi_ok) {
+        return false;
+    }
+    result.resize (length + 1);
+    napi_get_value_string_utf8 (env, value, &result[0], result.size (), &length);
+    result.resize (length);
+    return true;
+}
+
+static void GetStringParam (napi_env env, napi_value paramsVal, const char* name, std::string& param)
+{
+    napi_value value;
+    if (IsPropertySet (env, paramsVal, name, value)) {
+        GetString (env, value, param);
+    }
+}
+
+static void GetDoubleParam (napi_env env, napi_value paramsVal, const char* name, double& param)
+{
+    napi_value value;
+    if (IsPropertySet (env, paramsVal, name, value)) {
+        napi_get_value_double (env, value, &param);
+    }
+}
+
+static void GetIntParam (napi_env env, napi_value paramsVal, const char* name, int& param)
+{
+    napi_value value;
+    if (IsPropertySet (env, paramsVal, name, value)) {
+        napi_get_value_int32 (env, value, &param);
+    }
+}
+
+static void GetBoolParam (napi_env env, napi_value paramsVal, const char* name, bool& param)
+{
+    napi_value value;
+    if (IsPropertySet (env, paramsVal, name, value)) {
+        napi_get_value_bool (env, value, &param);
+    }
+}
+
+static void GetStringArrayParam (napi_env env, napi_value paramsVal, const char* name, std::vector<std::string>& param)
+{
+    napi_value value;
+    bool isArray = false;
+    if (!IsPropertySet (env, paramsVal, name, value) || napi_is_array (env, value, &isArray) != napi_ok || !isArray) {
+        return;
+    }
+    uint32_t length = 0;
+    napi_get_array_length (env, value, &length);
+    param.clear ();
+    for (uint32_t index = 0; index < length; index++) {
+        napi_value element;
+        std::string elementStr;
+        if (napi_get_element (env, value, index, &element) == napi_ok && GetString (env, element, elementStr)) {
+            param.push_back (elementStr);
+        }
+    }
+}
+
+static ImportParams GetImportParams (napi_env env, napi_value paramsVal)
+{
+    ImportParams params;
+    napi_valuetype paramsType = napi_undefined;
+    napi_typeof (env, paramsVal, &paramsType);
+    if (paramsType != napi_object) {
+        return params;
+    }
+
+    std::string linearUnitStr;
+    GetStringParam (env, paramsVal, "linearUnit", linearUnitStr);
+    if (linearUnitStr == "millimeter") {
+        params.linearUnit = ImportParams::LinearUnit::Millimeter;
+    } else if (linearUnitStr == "centimeter") {
+        params.linearUnit = ImportParams::LinearUnit::Centimeter;
+    } else if (linearUnitStr == "meter") {
+        params.linearUnit = ImportParams::LinearUnit::Meter;
+    } else if (linearUnitStr == "inch") {
+        params.linearUnit = ImportParams::LinearUnit::Inch;
+    } else if (linearUnitStr == "foot") {
+        params.linearUnit = ImportParams::LinearUnit::Foot;
+    }
+
+    std::string linearDeflectionTypeStr;
+    GetStringParam (env, paramsVal, "linearDeflectionType", linearDeflectionTypeStr);
+    if (linearDeflectionTypeStr == "bounding_box_ratio") {
+        params.linearDeflectionType = ImportParams::LinearDeflectionType::BoundingBoxRatio;
+    } else if (linearDeflectionTypeStr == "absolute_value") {
+        params.linearDeflectionType = ImportParams::LinearDeflectionType::AbsoluteValue;
+    } else if (linearDeflectionTypeStr == "triangle_budget") {
+        params.linearDeflectionType = ImportParams::LinearDeflectionType::TriangleBudget;
+    }
+
+    GetDoubleParam (env, paramsVal, "linearDeflection", params.linearDeflection);
+    GetDoubleParam (env, paramsVal, "angularDeflection", params.angularDeflection);
+    GetIntParam (env, paramsVal, "triangleBudget", params.triangleBudget);
+    GetBoolParam (env, paramsVal, "reuseTriangulation", params.reuseTriangulation);
+    GetDoubleParam (env, paramsVal, "decimationRatio", params.decimationRatio);
+    GetDoubleParam (env, paramsVal, "decimationMaxError", params.decimationMaxError);
+    GetBoolParam (env, paramsVal, "computeNormals", params.computeNormals);
+    GetBoolParam (env, paramsVal, "deduplicateSolids", params.deduplicateSolids);
+    GetStringArrayParam (env, paramsVal, "includeNodes", params.includeNodes);
+    GetStringArrayParam (env, paramsVal, "excludeNodes", params.excludeNodes);
+    GetBoolParam (env, paramsVal, "skipHiddenShapes", params.skipHiddenShapes);
+    GetStringArrayParam (env, paramsVal, "includeLayers", params.includeLayers);
+    GetStringArrayParam (env, paramsVal, "excludeLayers", params.excludeLayers);
+    return params;
+}
+
+static bool GetFileContent (napi_env env, napi_value buffer, std::vector<std::uint8_t>& fileContent)
+{
+    void* data = nullptr;
+    size_t byteLength = 0;
+
+    bool isTypedArray = false;
+    bool isArrayBuffer = false;
+    napi_is_typedarray (env, buffer, &isTypedArray);
+    napi_is_arraybuffer (env, buffer, &isArrayBuffer);
+    if (isTypedArray) {
+        // Buffer is also an Uint8Array
+        napi_typedarray_type arrayType;
+        size_t length = 0;
+        napi_value arrayBuffer;
+        size_t byteOffset = 0;
+        if (napi_get_typedarray_info (env, buffer, &arrayType, &length, &data, &arrayBuffer, &byteOffset) != napi_ok) {
+            return false;
+        }
+        if (arrayType != napi_uint8_array && arrayType != napi_int8_array && arrayType != napi_uint8_clamped_array) {
+            return false;
+        }
+        byteLength = length;
+    } else if (isArrayBuffer) {
+        if (napi_get_arraybuffer_info (env, buffer, &data, &byteLength) != napi_ok) {
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    // the content is copied, because the worker thread can't access the javascript objects
+    const std::uint8_t* begin = (const std::uint8_t*) data;
+    fileContent.assign (begin, begin + byteLength);
+    return true;
+}
+
+static bool GetBytesParam (napi_env env, napi_value paramsVal, const char* name, std::vector<std::uint8_t>& param)
+{
+    napi_valuetype paramsType = napi_undefined;
+    napi_typeof (env, paramsVal, &paramsType);
+    napi_value value;
+    if (paramsType != napi_object || !IsPropertySet (env, paramsVal, name, value)) {
+        return false;
+    }
+    return GetFileContent (env, value, param);
+}
+
+class ResultWriter
+{
+public:
+    ResultWriter (napi_env env) :
+        env (env)
+    {
+
+    }
+
+    napi_value CreateObject ()
+    {
+        napi_value object;
+        napi_create_object (env, &object);
+        return object;
+    }
+
+    napi_value CreateArray (size_t length)
+    {
+        napi_value array;
+        napi_create_array_with_length (env, length, &array);
+        return array;
+    }
+
+    napi_value CreateString (const std::string& value)
+    {
+        napi_value string;
+        napi_create_string_utf8 (env, value.c_str (), value.length (), &string);
+        return string;
+    }
+
+    napi_value CreateNumber (double value)
+    {
+        napi_value number;
+        napi_create_double (env, value, &number);
+        return number;
+    }
+
+    napi_value CreateBoolean (bool value)
+    {
+        napi_value boolean;
+        napi_get_boolean (env, value, &boolean);
+        return boolean;
+    }
+
+    napi_value CreateNull ()
+    {
+        napi_value null;
+        napi_get_null (env, &null);
+        return null;
+    }
+
+    template <typename T>
+    napi_value CreateTypedArray (napi_typedarray_type arrayType, const std::vector<T>& values)
+    {
+        void* data = nullptr;
+        napi_value arrayBuffer;
+        napi_create_arraybuffer (env, values.size () * sizeof (T), &data, &arrayBuffer);
+        if (!values.empty ()) {
+            std::memcpy (data, values.data (), values.size () * sizeof (T));
+        }
+        napi_value typedArray;
+        napi_create_typedarray (env, arrayType, values.size (), arrayBuffer, 0, &typedArray);
+        return typedArray;
+    }
+
+    napi_value CreateColorArray (const Color& color)
+    {
+        napi_value colorArr = CreateArray (3);
+        napi_set_element (env, colorArr, 0, CreateNumber (color.r));
+        napi_set_element (env, colorArr, 1, CreateNumber (color.g));
+        napi_set_element (env, colorArr, 2, CreateNumber (color.b));
+        return colorArr;
+    }
+
+    void Set (napi_value object, const char* name, napi_value value)
+    {
+        napi_set_named_property (env, object, name, value);
+    }
+
+    napi_value WriteNode (const ResultNode& node)
+    {
+        napi_value nodeObj = CreateObject ();
+        Set (nodeObj, "name", CreateString (node.name));
+
+        napi_value nodeMeshesArr = CreateArray (node.meshes.size ());
+        for (size_t nodeMeshIndex = 0; nodeMeshIndex < node.meshes.size (); nodeMeshIndex++) {
+            napi_set_element (env, nodeMeshesArr, (uint32_t) nodeMeshIndex, CreateNumber (node.meshes[nodeMeshIndex]));
+        }
+        Set (nodeObj, "meshes", nodeMeshesArr);
+
+        napi_value childrenArr = CreateArray (node.children.size ());
+        for (size_t childIndex = 0; childIndex < node.children.size (); childIndex++) {
+            napi_set_element (env, childrenArr, (uint32_t) childIndex, WriteNode (node.children[childIndex]));
+        }
+        Set (nodeObj, "children", childrenArr);
+        return nodeObj;
+    }
+
+    napi_value WriteMesh (const ResultMesh& mesh)
+    {
+        napi_value meshObj = CreateObject ();
+        Set (meshObj, "name", CreateString (mesh.name));
+
+        napi_value attributesObj = CreateObject ();
+
+        napi_value positionObj = CreateObject ();
+        Set (positionObj, "array", CreateTypedArray (napi_float32_array, std::vector<float> (mesh.positions.begin (), mesh.positions.end ())));
+        Set (attributesObj, "position", positionObj);
+
+        if (mesh.positions.size () == mesh.normals.size ()) {
+            napi_value normalObj = CreateObject ();
+            Set (normalObj, "array", CreateTypedArray (napi_float32_array, std::vector<float> (mesh.normals.begin (), mesh.normals.end ())));
+            Set (attributesObj, "normal", normalObj);
+        }
+
+        napi_value indexObj = CreateObject ();
+        Set (indexObj, "array", CreateTypedArray (napi_uint32_array, mesh.indices));
+
+        Set (meshObj, "attributes", attributesObj);
+        Set (meshObj, "index", indexObj);
+
+        if (mesh.hasColor) {
+            Set (meshObj, "color", CreateColorArray (mesh.color));
+        }
+
+        napi_value brepFaceArr = CreateArray (mesh.brepFaces.size ());
+        for (size_t brepFaceIndex = 0; brepFaceIndex < mesh.brepFaces.size (); brepFaceIndex++) {
+            const ResultBrepFace& brepFace = mesh.brepFaces[brepFaceIndex];
+            napi_value brepFaceObj = CreateObject ();
+            Set (brepFaceObj, "first", CreateNumber (brepFace.first));
+            Set (brepFaceObj, "last", CreateNumber (brepFace.last));
+            Set (brepFaceObj, "color", brepFace.hasColor ? CreateColorArray (brepFace.color) : CreateNull ());
+            napi_set_element (env, brepFaceArr, (uint32_t) brepFaceIndex, brepFaceObj);
+        }
+        Set (meshObj, "brep_faces", brepFaceArr);
+        return meshObj;
+    }
+
+    napi_value WriteResult (bool success, const ImportResult& result)
+    {
+        napi_value resultObj = CreateObject ();
+        Set (resultObj, "success", CreateBoolean (success));
+        if (!success) {
+            return resultObj;
+        }
+
+        napi_value meshesArr = CreateArray (result.meshes.size ());
+        for (size_t meshIndex = 0; meshIndex < result.meshes.size (); meshIndex++) {
+            napi_set_element (env, meshesArr, (uint32_t) meshIndex, WriteMesh (result.meshes[meshIndex]));
+        }
+
+        Set (resultObj, "root", WriteNode (result.root));
+        Set (resultObj, "meshes", meshesArr);
+        return resultObj;
+    }
+
+private:
+    napi_env env;
+};
+
+class ImportTask
+{
+public:
+    ImportTask (const std::string& format) :
+        format (format),
+        params (),
+        fileContent (),
+        success (false),
+        result (),
+        deferred (nullptr),
+        work (nullptr),
+        cacheOutput (false),
+        reuseOutput (false),
+        trace (false),
+        hasCacheData (false),
+        hasPreviousData (false),
+        cacheData (),
+        previousData (),
+        cacheKey (),
+        cacheHit (false),
+        outputCacheData (),
+        reusedMeshCount (0),
+        traceJson ()
+    {
+
+    }
+
+    std::string format;
+    ImportParams params;
+    std::vector<std::uint8_t> fileContent;
+    bool success;
+    ImportResult result;
+    napi_deferred deferred;
+    napi_async_work work;
+
+    // the same cache, reuse and trace parameters as in the wasm module
+    bool cacheOutput;
+    bool reuseOutput;
+    bool trace;
+    bool hasCacheData;
+    bool hasPreviousData;
+    std::vector<std::uint8_t> cacheData;
+    std::vector<std::uint8_t> previousData;
+
+    std::string cacheKey;
+    bool cacheHit;
+    std::vector<std::uint8_t> outputCacheData;
+    int reusedMeshCount;
+    std::string traceJson;
+};
+
+static ImporterPtr CreateImporter (const std::string& format)
+{
+    if (format == "step") {
+        return std::make_shared<ImporterStep> ();
+    } else if (format == "iges") {
+        return std::make_shared<ImporterIges> ();
+    } else if (format == "brep") {
+        return std::make_shared<ImporterBrep> ();
+    }
+    return nullptr;
+}
+
+static bool GetCachedResult (const ImportTask* task, ImportResult& result)
+{
+    if (!task->hasCacheData) {
+        return false;
+    }
+
+    std::string storedCacheKey;
+    ImportResult storedResult;
+    if (!DeserializeResult (task->cacheData, storedCacheKey, storedResult) || storedCacheKey != task->cacheKey) {
+        return false;
+    }
+    result = std::move (storedResult);
+    return true;
+}
+
+static void ImportWithCache (ImportTask* task, Tracer& tracer)
+{
+    bool useCache = task->cacheOutput || task->hasCacheData;
+    if (useCache) {
+        task->cacheKey = GetCacheKey (task->format, task->fileContent, task->params);
+    }
+
+    // the keys of the meshes are needed only if the result will be used by a later import, or it uses an earlier one
+    MeshReuse meshReuse;
+    if ((task->cacheOutput && task->reuseOutput) || task->hasPreviousData) {
+        std::string previousCacheKey;
+        ImportResult previousResult;
+        if (task->hasPreviousData && DeserializeResult (task->previousData, previousCacheKey, previousResult)) {
+            meshReuse.AddPreviousResult (previousResult);
+        }
+        task->params.meshReuse = &meshReuse;
+    }
+    if (task->trace) {
+        task->params.tracer = &tracer;
+    }
+
+    task->cacheHit = useCache && GetCachedResult (task, task->result);
+    if (task->cacheHit) {
+        task->success = true;
+    } else {
+        TraceScope importScope (task->params.tracer, "Import");
+        importScope.AddArg ("format", task->format);
+        ImporterPtr importer = CreateImporter (task->format);
+        if (importer == nullptr) {
+            return;
+        }
+        Importer::Result loadResult = importer->LoadFile (task->fileContent, task->params);
+        if (loadResult == Importer::Result::Success) {
+            ExtractResult (importer->GetRootNode (), task->params, task->result);
+            task->success = true;
+        }
+        meshReuse.ReleaseShapes ();
+        ReleaseImporter (importer);
+    }
+
+    task->reusedMeshCount = meshReuse.GetReusedMeshCount ();
+    if (task->success && task->cacheOutput && !task->cacheHit) {
+        SerializeResult (task->result, task->cacheKey, task->outputCacheData);
+    }
+}
+
+static void ExecuteImportTask (napi_env, void* data)
+{
+    // runs on a worker thread of the libuv pool, so javascript can't be accessed here
+    ImportTask* task = (ImportTask*) data;
+    Tracer tracer;
+    try {
+        ImportWithCache (task, tracer);
+    } catch (const Standard_Failure&) {
+        task->success = false;
+    } catch (const std::exception&) {
+        task->success = false;
+    } catch (...) {
+        // an exception can't leave the worker thread, it would terminate the process
+        task->success = false;
+    }
+
+    // the parameters refer to objects of this function, so they are cleared before returning
+    task->params.meshReuse = nullptr;
+    task->params.tracer = nullptr;
+    if (task->trace) {
+        task->traceJson = tracer.GetJson ();
+    }
+}
+
+static void CompleteImportTask (napi_env env, napi_status status, void* data)
+{
+    ImportTask* task = (ImportTask*) data;
+    ResultWriter writer (env);
+    bool success = (status == napi_ok && task->success);
+    napi_value resultObj = writer.WriteResult (success, task->result);
+    if (success && task->hasPreviousData) {
+        writer.Set (resultObj, "reusedMeshes", writer.CreateNumber (task->reusedMeshCount));
+    }
+    if (success && task->cacheOutput) {
+        writer.Set (resultObj, "cacheKey", writer.CreateString (task->cacheKey));
+        writer.Set (resultObj, "cacheHit", writer.CreateBoolean (task->cacheHit));
+        if (!task->cacheHit) {
+            writer.Set (resultObj, "cacheData", writer.CreateTypedArray (napi_uint8_array, task->outputCacheData));
+        }
+    }
+    if (task->trace) {
+        writer.Set (resultObj, "trace", writer.CreateString (task->traceJson));
+    }
+    napi_resolve_deferred (env, task->deferred, resultObj);
+    napi_delete_async_work (env, task->work);
+    delete task;
+}
+
+static napi_value StartImportTask (napi_env env, const std::string& format, napi_value buffer, napi_value paramsVal)
+{
+    ImportTask* task = new ImportTask (format);
+    if (!GetFileContent (env, buffer, task->fileContent)) {
+        delete task;
+        napi_throw_type_error (env, nullptr, "The content must be a Buffer, a Uint8Array or an ArrayBuffer.");
+        return nullptr;
+    }
+    task->params = GetImportParams (env, paramsVal);
+    GetBoolParam (env, paramsVal, "cacheOutput", task->cacheOutput);
+    GetBoolParam (env, paramsVal, "reuseOutput", task->reuseOutput);
+    GetBoolParam (env, paramsVal, "trace", task->trace);
+    task->hasCacheData = GetBytesParam (env, paramsVal, "cacheData", task->cacheData);
+    task->hasPreviousData = GetBytesParam (env, paramsVal, "previousData", task->previousData);
+
+    napi_value promise;
+    napi_create_promise (env, &task->deferred, &promise);
+
+    napi_value resourceName;
+    napi_create_string_utf8 (env, "OcctImportJS", NAPI_AUTO_LENGTH, &resourceName);
+    napi_create_async_work (env, nullptr, resourceName, ExecuteImportTask, CompleteImportTask, task, &task->work);
+    napi_queue_async_work (env, task->work);
+    return promise;
+}
+
+static napi_value ReadFormatFile (napi_env env, napi_callback_info info, const std::string& format)
+{
+    size_t argc = 2;
+    napi_value argv[2];
+    napi_get_cb_info (env, info, &argc, argv, nullptr, nullptr);
+    if (argc < 1) {
+        napi_throw_type_error (env, nullptr, "Missing file content.");
+        return nullptr;
+    }
+    napi_value paramsVal = nullptr;
+    if (argc > 1) {
+        paramsVal = argv[1];
+    } else {
+        napi_get_null (env, &paramsVal);
+    }
+    return StartImportTask (env, format, argv[0], paramsVal);
+}
+
+static napi_value ReadStepFile (napi_env env, napi_callback_info info)
+{
+    return ReadFormatFile (env, info, "step");
+}
+
+static napi_value ReadIgesFile (napi_env env, napi_callback_info info)
+{
+    return ReadFormatFile (env, info, "iges");
+}
+
+static napi_value ReadBrepFile (napi_env env, napi_callback_info info)
+{
+    return ReadFormatFile (env, info, "brep");
+}
+
+static napi_value ReadFile (napi_env env, napi_callback_info info)
+{
+    size_t argc = 3;
+    napi_value argv[3];
+    napi_get_cb_info (env, info, &argc, argv, nullptr, nullptr);
+    std::string format;
+    if (argc < 2 || !GetString (env, argv[0], format)) {
+        napi_throw_type_error (env, nullptr, "Missing format or file content.");
+        return nullptr;
+    }
+    napi_value paramsVal = nullptr;
+    if (argc > 2) {
+        paramsVal = argv[2];
+    } else {
+        napi_get_null (env, &paramsVal);
+    }
+    return StartImportTask (env, format, argv[1], paramsVal);
+}
+
+NAPI_MODULE_INIT ()
+{
+    napi_property_descriptor properties[] = {
+        { "ReadFile", nullptr, ReadFile, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "ReadStepFile", nullptr, ReadStepFile, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "ReadIgesFile", nullptr, ReadIgesFile, nullptr, nullptr, nullptr, napi_default, nullptr },
+        { "ReadBrepFile", nullptr, ReadBrepFile, nullptr, nullptr, nullptr, napi_default, nullptr }
+    };
+    napi_define_properties (env, exports, sizeof (properties) / sizeof (properties[0]), properties);
+    return exports;
+}
@@ -0,0 +1,6 @@
+// Switches the OCCT memory manager to the pooled allocator. It must be set before
+// the static initializers run, because the memory manager is created only once.
+Module['preRun'] = [].concat (Module['preRun'] || []);
+Module['preRun'].push (function () {
+    ENV['MMGT_OPT'] = '1';
+});
@@ -0,0 +1,263 @@
+#ifndef EMSCRIPTEN
+
+#include "c-interface.hpp"
+#include "importer-step.hpp"
+#include "importer-iges.hpp"
+#include "importer-brep.hpp"
+#include "importer-result.hpp"
+#include "importer-utils.hpp"
+#include "importer-trace.hpp"
+#include "importer-cache.hpp"
+
+#include <Standard_Failure.hxx>
+
+#include <exception>
+
+struct oij_import
+{
+    oij_format format;
+    ImportParams params;
+    std::string traceFile;
+    std::string cacheFolder;
+    ImportResult result;
+    bool cacheHit;
+};
+
+static std::vector<std::string> GetStringArray (const char* const* strings, size_t count)
+{
+    std::vector<std::string> result;
+    if (strings == nullptr) {
+        return result;
+    }
+    for (size_t index = 0; index < count; index++) {
+        if (strings[index] != nullptr) {
+            result.push_back (strings[index]);
+        }
+    }
+    return result;
+}
+
+static ImportParams GetImportParams (const oij_import_params& params)
+{
+    ImportParams importParams;
+    importParams.linearUnit = (ImportParams::LinearUnit) params.linear_unit;
+    importParams.linearDeflectionType = (ImportParams::LinearDeflectionType) params.linear_deflection_type;
+    importParams.linearDeflection = params.linear_deflection;
+    importParams.angularDeflection = params.angular_deflection;
+    importParams.triangleBudget = params.triangle_budget;
+    importParams.reuseTriangulation = (params.reuse_triangulation != 0);
+    importParams.decimationRatio = params.decimation_ratio;
+    importParams.decimationMaxError = params.decimation_max_error;
+    importParams.computeNormals = (params.compute_normals != 0);
+    importParams.deduplicateSolids = (params.deduplicate_solids != 0);
+    importParams.includeNodes = GetStringArray (params.include_nodes, params.include_node_count);
+    importParams.excludeNodes = GetStringArray (params.exclude_nodes, params.exclude_node_count);
+    importParams.skipHiddenShapes = (params.skip_hidden_shapes != 0);
+    importParams.includeLayers = GetStringArray (params.include_layers, params.include_layer_count);
+    importParams.excludeLayers = GetStringArray (params.exclude_layers, params.exclude_layer_count);
+    return importParams;
+}
+
+void oij_import_params_init (oij_import_params* params)
+{
+    if (params == nullptr) {
+        return;
+    }
+
+    // exceptions must not cross the c interface
+    try {
+        ImportParams defaultParams;
+        params->linear_unit = (oij_linear_unit) defaultParams.linearUnit;
+        params->linear_deflection_type = (oij_linear_deflection_type) defaultParams.linearDeflectionType;
+        params->linear_deflection = defaultParams.linearDeflection;
+        params->angular_deflection = defaultParams.angularDeflection;
+        params->triangle_budget = defaultParams.triangleBudget;
+        params->reuse_triangulation = defaultParams.reuseTriangulation ? 1 : 0;
+        params->decimation_ratio = defaultParams.decimationRatio;
+        params->decimation_max_error = defaultParams.decimationMaxError;
+        params->compute_normals = defaultParams.computeNormals ? 1 : 0;
+        params->deduplicate_solids = defaultParams.deduplicateSolids ? 1 : 0;
+        params->include_nodes = nullptr;
+        params->include_node_count = 0;
+        params->exclude_nodes = nullptr;
+        params->exclude_node_count = 0;
+        params->skip_hidden_shapes = defaultParams.skipHiddenShapes ? 1 : 0;
+        params->include_layers = nullptr;
+        params->include_layer_count = 0;
+        params->exclude_layers = nullptr;
+        params->exclude_layer_count = 0;
+        params->trace_file = nullptr;
+        params->cache_folder = nullptr;
+    } catch (...) {
+        return;
+    }
+}
+
+static ImporterPtr CreateImporter (oij_format format)
+{
+    switch (format) {
+        case OIJ_FORMAT_STEP:
+            return std::make_shared<ImporterStep> ();
+        case OIJ_FORMAT_IGES:
+            return std::make_shared<ImporterIges> ();
+        case OIJ_FORMAT_BREP:
+            return std::make_shared<ImporterBrep> ();
+    }
+    return nullptr;
+}
+
+static std::string GetFormatName (oij_format format)
+{
+    // the same names as in the javascript interface, so the cache keys are the same
+    switch (format) {
+        case OIJ_FORMAT_STEP:
+            return "step";
+        case OIJ_FORMAT_IGES:
+            return "iges";
+        case OIJ_FORMAT_BREP:
+            return "brep";
+    }
+    return std::string ();
+}
+
+oij_import* oij_import_create (oij_format format, const oij_import_params* params)
+{
+    if (format != OIJ_FORMAT_STEP && format != OIJ_FORMAT_IGES && format != OIJ_FORMAT_BREP) {
+        return nullptr;
+    }
+
+    try {
+        oij_import* import = new oij_import ();
+        import->format = format;
+        import->cacheHit = false;
+        if (params != nullptr) {
+            import->params = GetImportParams (*params);
+            if (params->trace_file != nullptr) {
+                import->traceFile = params->trace_file;
+            }
+            if (params->cache_folder != nullptr) {
+                import->cacheFolder = params->cache_folder;
+            }
+        }
+        return import;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+oij_result oij_import_run (oij_import* import, const uint8_t* content, size_t size)
+{
+    if (import == nullptr || (content == nullptr && size > 0)) {
+        return OIJ_RESULT_INVALID_ARGUMENT;
+    }
+
+    // exceptions must not cross the c interface
+    try {
+        // only the extracted result is kept, the importer is released after every run
+        import->result = ImportResult ();
+        import->cacheHit = false;
+        ImportParams params = import->params;
+        Tracer tracer;
+        if (!import->traceFile.empty ()) {
+            params.tracer = &tracer;
+        }
+
+        std::vector<std::uint8_t> fileContent (content, content + size);
+        std::string cacheKey;
+        if (!import->cacheFolder.empty ()) {
+            cacheKey = GetCacheKey (GetFormatName (import->format), fileContent, params);
+            ResultCache cache (import->cacheFolder);
+            if (cache.Load (cacheKey, import->result)) {
+                import->cacheHit = true;
+                return OIJ_RESULT_SUCCESS;
+            }
+            // a corrupt entry can leave a partial result behind
+            import->result = ImportResult ();
+        }
+
+        ImporterPtr importer = CreateImporter (import->format);
+        Importer::Result loadResult = Importer::Result::ImportFailed;
+        {
+            TraceScope importScope (params.tracer, "Import");
+            loadResult = importer->LoadFile (fileContent, params);
+            if (loadResult == Importer::Result::Success) {
+                ExtractResult (importer->GetRootNode (), params, import->result);
+            }
+            ReleaseImporter (importer);
+        }
+        if (params.tracer != nullptr) {
+            tracer.WriteFile (import->traceFile);
+        }
+        if (loadResult != Importer::Result::Success) {
+            return OIJ_RESULT_IMPORT_FAILED;
+        }
+        if (!cacheKey.empty ()) {
+            // a failed store only means that the next run imports the file again
+            ResultCache cache (import->cacheFolder);
+            cache.Store (cacheKey, import->result);
+        }
+    } catch (const Standard_Failure&) {
+        return OIJ_RESULT_IMPORT_FAILED;
+    } catch (const std::exception&) {
+        return OIJ_RESULT_IMPORT_FAILED;
+    } catch (...) {
+        return OIJ_RESULT_IMPORT_FAILED;
+    }
+
+    return OIJ_RESULT_SUCCESS;
+}
+
+int oij_is_cache_hit (const oij_import* import)
+{
+    if (import == nullptr) {
+        return 0;
+    }
+    return import->cacheHit ? 1 : 0;
+}
+
+size_t oij_get_mesh_count (const oij_import* import)
+{
+    if (import == nullptr) {
+        return 0;
+    }
+    try {
+        return import->result.meshes.size ();
+    } catch (...) {
+        return 0;
+    }
+}
+
+oij_result oij_get_mesh_buffers (const oij_import* import, size_t mesh_index, oij_mesh_buffers* buffers)
+{
+    if (import == nullptr || buffers == nullptr || mesh_index >= import->result.meshes.size ()) {
+        return OIJ_RESULT_INVALID_ARGUMENT;
+    }
+
+    try {
+        const ResultMesh& mesh = import->result.meshes[mesh_index];
+        buffers->name = mesh.name.c_str ();
+        buffers->has_color = mesh.hasColor ? 1 : 0;
+        buffers->color[0] = mesh.color.r;
+        buffers->color[1] = mesh.color.g;
+        buffers->color[2] = mesh.color.b;
+        buffers->positions = mesh.positions.data ();
+        buffers->normals = (mesh.normals.size () == mesh.positions.size () ? mesh.normals.data () : nullptr);
+        buffers->vertex_count = mesh.positions.size () / 3;
+        buffers->indices = mesh.indices.data ();
+        buffers->triangle_count = mesh.indices.size () / 3;
+    } catch (...) {
+        return OIJ_RESULT_INVALID_ARGUMENT;
+    }
+    return OIJ_RESULT_SUCCESS;
+}
+
+void oij_import_free (oij_import* import)
+{
+    try {
+        delete import;
+    } catch (...) {
+        return;
+    }
+}
+
+#endif
@@ -0,0 +1,109 @@
+#ifndef OCCTIMPORTJS_C_INTERFACE_HPP
+#define OCCTIMPORTJS_C_INTERFACE_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Every import object is independent, so different import objects can be used
+// from different threads at the same time. One import object must not be used
+// from multiple threads at the same time. Exceptions never cross this interface,
+// errors are returned as oij_result values or null pointers.
+
+typedef struct oij_import oij_import;
+
+typedef enum
+{
+    OIJ_FORMAT_STEP = 0,
+    OIJ_FORMAT_IGES = 1,
+    OIJ_FORMAT_BREP = 2
+} oij_format;
+
+typedef enum
+{
+    OIJ_RESULT_SUCCESS = 0,
+    OIJ_RESULT_IMPORT_FAILED = 1,
+    OIJ_RESULT_INVALID_ARGUMENT = 2
+} oij_result;
+
+typedef enum
+{
+    OIJ_LINEAR_UNIT_MILLIMETER = 0,
+    OIJ_LINEAR_UNIT_CENTIMETER = 1,
+    OIJ_LINEAR_UNIT_METER = 2,
+    OIJ_LINEAR_UNIT_INCH = 3,
+    OIJ_LINEAR_UNIT_FOOT = 4
+} oij_linear_unit;
+
+typedef enum
+{
+    OIJ_LINEAR_DEFLECTION_BOUNDING_BOX_RATIO = 0,
+    OIJ_LINEAR_DEFLECTION_ABSOLUTE_VALUE = 1,
+    OIJ_LINEAR_DEFLECTION_TRIANGLE_BUDGET = 2
+} oij_linear_deflection_type;
+
+// always initialize with oij_import_params_init before changing the values
+typedef struct
+{
+    oij_linear_unit linear_unit;
+    oij_linear_deflection_type linear_deflection_type;
+    double linear_deflection;
+    double angular_deflection;
+    int triangle_budget;
+    int reuse_triangulation;
+    double decimation_ratio;
+    double decimation_max_error;
+    int compute_normals;
+    int deduplicate_solids;
+    // node name, path or label entry patterns, the strings are copied by oij_import_create
+    const char* const* include_nodes;
+    size_t include_node_count;
+    const char* const* exclude_nodes;
+    size_t exclude_node_count;
+    int skip_hidden_shapes;
+    // layer name patterns, the strings are copied by oij_import_create
+    const char* const* include_layers;
+    size_t include_layer_count;
+    const char* const* exclude_layers;
+    size_t exclude_layer_count;
+    // if not null, a chrome trace of every run is written to this file
+    const char* trace_file;
+    // if not null, the results are stored in this existing folder, and a run with
+    // the same content and params loads the result from there instead of importing
+    const char* cache_folder;
+} oij_import_params;
+
+// the buffers are owned by the import object, and valid until it is freed
+typedef struct
+{
+    const char* name;
+    int has_color;
+    double color[3];
+    // three values per vertex
+    const double* positions;
+    // three values per vertex, or null if normals are not computed
+    const double* normals;
+    size_t vertex_count;
+    // three values per triangle
+    const uint32_t* indices;
+    size_t triangle_count;
+} oij_mesh_buffers;
+
+void oij_import_params_init (oij_import_params* params);
+
+oij_import* oij_import_create (oij_format format, const oij_import_params* params);
+oij_result oij_import_run (oij_import* import, const uint8_t* content, size_t size);
+// 1 if the result of the last successful run was loaded from the cache folder
+int oij_is_cache_hit (const oij_import* import);
+size_t oij_get_mesh_count (const oij_import* import);
+oij_result oij_get_mesh_buffers (const oij_import* import, size_t mesh_index, oij_mesh_buffers* buffers);
+void oij_import_free (oij_import* import);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
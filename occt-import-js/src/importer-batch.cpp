@@ -0,0 +1,78 @@
+#include "importer-batch.hpp"
+
+#include <map>
+#include <tuple>
+
+using BatchKey = std::tuple<bool, double, double, double, bool>;
+
+static BatchKey GetBatchKey (const ResultMesh& mesh)
+{
+    // meshes can be merged only if they have the same color, and all of them have normals or none of them
+    bool hasNormals = (mesh.normals.size () == mesh.positions.size ());
+    if (!mesh.hasColor) {
+        return BatchKey (false, 0.0, 0.0, 0.0, hasNormals);
+    }
+    return BatchKey (true, mesh.color.r, mesh.color.g, mesh.color.b, hasNormals);
+}
+
+static void AppendMesh (const ResultMesh& mesh, int meshIndex, ResultBatch& batch)
+{
+    std::uint32_t vertexOffset = (std::uint32_t) (batch.positions.size () / 3);
+    int triangleOffset = (int) (batch.indices.size () / 3);
+
+    batch.positions.insert (batch.positions.end (), mesh.positions.begin (), mesh.positions.end ());
+    if (mesh.normals.size () == mesh.positions.size ()) {
+        batch.normals.insert (batch.normals.end (), mesh.normals.begin (), mesh.normals.end ());
+    }
+    batch.indices.reserve (batch.indices.size () + mesh.indices.size ());
+    for (std::uint32_t index : mesh.indices) {
+        batch.indices.push_back (vertexOffset + index);
+    }
+    batch.ranges.push_back (ResultBatchRange (meshIndex, triangleOffset, (int) (mesh.indices.size () / 3)));
+}
+
+ResultBatchRange::ResultBatchRange (int mesh, int firstTriangle, int triangleCount) :
+    mesh (mesh),
+    firstTriangle (firstTriangle),
+    triangleCount (triangleCount)
+{
+
+}
+
+ResultBatch::ResultBatch () :
+    hasColor (false),
+    color (),
+    positions (),
+    normals (),
+    indices (),
+    ranges ()
+{
+
+}
+
+void BatchMeshes (const ImportResult& result, size_t maxVertexCount, std::vector<ResultBatch>& batches)
+{
+    batches.clear ();
+
+    // the batch that is currently filled for every key, meshes over the limit get their own batch
+    std::map<BatchKey, size_t> openBatches;
+    for (size_t meshIndex = 0; meshIndex < result.meshes.size (); meshIndex++) {
+        const ResultMesh& mesh = result.meshes[meshIndex];
+        if (mesh.indices.empty ()) {
+            continue;
+        }
+
+        BatchKey key = GetBatchKey (mesh);
+        size_t meshVertexCount = mesh.positions.size () / 3;
+        auto found = openBatches.find (key);
+        if (found == openBatches.end () || batches[found->second].positions.size () / 3 + meshVertexCount > maxVertexCount) {
+            ResultBatch batch;
+            batch.hasColor = mesh.hasColor;
+            batch.color = mesh.color;
+            batches.push_back (batch);
+            openBatches[key] = batches.size () - 1;
+        }
+
+        AppendMesh (mesh, (int) meshIndex, batches[openBatches[key]]);
+    }
+}
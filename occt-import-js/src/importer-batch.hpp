@@ -0,0 +1,29 @@
+#pragma once
+
+#include "importer-result.hpp"
+
+class ResultBatchRange
+{
+public:
+    ResultBatchRange (int mesh, int firstTriangle, int triangleCount);
+
+    int mesh;
+    int firstTriangle;
+    int triangleCount;
+};
+
+class ResultBatch
+{
+public:
+    ResultBatch ();
+
+    bool hasColor;
+    Color color;
+
+    std::vector<double> positions;
+    std::vector<double> normals;
+    std::vector<std::uint32_t> indices;
+    std::vector<ResultBatchRange> ranges;
+};
+
+void BatchMeshes (const ImportResult& result, size_t maxVertexCount, std::vector<ResultBatch>& batches);
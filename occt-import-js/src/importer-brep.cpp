@@ -1,5 +1,9 @@
 #include "importer-brep.hpp"
 #include "importer-utils.hpp"
+#include "importer-decompress.hpp"
+#include "importer-dedup.hpp"
+#include "importer-reuse.hpp"
+#include "importer-trace.hpp"
 
 #include <TopExp_Explorer.hxx>
 #include <TopoDS.hxx>
@@ -10,9 +14,10 @@
 class BrepShapeMesh : public Mesh
 {
 public:
-    BrepShapeMesh (const TopoDS_Shape& shape) :
+    BrepShapeMesh (const TopoDS_Shape& shape, const MeshReuse* meshReuse) :
         Mesh (),
-        shape (shape)
+        shape (shape),
+        meshReuse (meshReuse)
     {
 
     }
@@ -22,6 +27,14 @@ public:
         return std::string ();
     }
 
+    virtual std::string GetShapeKey () const override
+    {
+        if (meshReuse == nullptr) {
+            return std::string ();
+        }
+        return meshReuse->GetShapeKey (shape);
+    }
+
     virtual bool GetColor (Color&) const override
     {
         return false;
@@ -38,6 +51,7 @@ public:
 
 private:
     const TopoDS_Shape& shape;
+    const MeshReuse* meshReuse;
 };
 
 class BrepStandaloneFacesMesh : public Mesh
@@ -61,6 +75,11 @@ public:
         return std::string ();
     }
 
+    virtual std::string GetShapeKey () const override
+    {
+        return std::string ();
+    }
+
     virtual bool GetColor (Color&) const override
     {
         return false;
@@ -82,8 +101,9 @@ private:
 class BrepNode : public Node
 {
 public:
-    BrepNode (const TopoDS_Shape& shape) :
-        shape (shape)
+    BrepNode (const TopoDS_Shape& shape, const MeshReuse* meshReuse) :
+        shape (shape),
+        meshReuse (meshReuse)
     {
 
     }
@@ -108,14 +128,14 @@ public:
         // Enumerate solids
         for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
             const TopoDS_Shape& currentShape = ex.Current ();
-            BrepShapeMesh outputShapeMesh (currentShape);
+            BrepShapeMesh outputShapeMesh (currentShape, meshReuse);
             onMesh (outputShapeMesh);
         }
 
         // Enumerate shells that are not part of a solid
         for (TopExp_Explorer ex (shape, TopAbs_SHELL, TopAbs_SOLID); ex.More (); ex.Next ()) {
             const TopoDS_Shape& currentShape = ex.Current ();
-            BrepShapeMesh outputShapeMesh (currentShape);
+            BrepShapeMesh outputShapeMesh (currentShape, meshReuse);
             onMesh (outputShapeMesh);
         }
 
@@ -128,31 +148,48 @@ public:
 
 private:
     const TopoDS_Shape& shape;
+    const MeshReuse* meshReuse;
 };
 
 ImporterBrep::ImporterBrep () :
     Importer (),
-    shape ()
+    shape (),
+    meshReuse (nullptr)
 {
 
 }
 
-Importer::Result ImporterBrep::LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params)
+Importer::Result ImporterBrep::LoadStream (std::istream& inputStream, const ImportParams& params)
 {
-    VectorBuffer inputBuffer (fileContent);
-    std::istream inputStream (&inputBuffer);
+    if (!params.IsValid ()) {
+        return Importer::Result::ImportFailed;
+    }
 
     BRep_Builder builder;
-    BRepTools::Read (shape, inputStream, builder);
-    if (shape.IsNull ()) {
+    bool read = false;
+    {
+        TraceScope readScope (params.tracer, "ReadStream");
+        read = ReadDecompressedStream (inputStream, [&] (std::istream& decompressedStream) {
+            BRepTools::Read (shape, decompressedStream, builder);
+            return !shape.IsNull ();
+        });
+    }
+    if (!read || shape.IsNull ()) {
         return Importer::Result::ImportFailed;
     }
 
-    TriangulateShape (shape, params);
+    meshReuse = params.meshReuse;
+    SolidDeduplicator deduplicator (params);
+    {
+        TraceScope deduplicateScope (params.tracer, "FindDuplicates");
+        deduplicator.AddShape (shape);
+    }
+    TriangulateShape (shape, params, deduplicator);
+    deduplicator.TransferTriangulations ();
     return Importer::Result::Success;
 }
 
 NodePtr ImporterBrep::GetRootNode () const
 {
-    return std::make_shared<BrepNode> (shape);
+    return std::make_shared<BrepNode> (shape, meshReuse);
 }
@@ -9,9 +9,10 @@ class ImporterBrep : public Importer
 public:
     ImporterBrep ();
 
-    virtual Result LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params) override;
+    virtual Result LoadStream (std::istream& inputStream, const ImportParams& params) override;
     virtual NodePtr GetRootNode () const override;
 
 private:
     TopoDS_Shape shape;
+    const MeshReuse* meshReuse;
 };
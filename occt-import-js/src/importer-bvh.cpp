@@ -0,0 +1,86 @@
+#include "importer-bvh.hpp"
+
+#include <BVH_Triangulation.hxx>
+#include <BVH_BinnedBuilder.hxx>
+
+#include <cmath>
+#include <limits>
+
+static const int BvhLeafNodeSize = 8;
+static const int BvhMaxTreeDepth = 32;
+
+ResultBvh::ResultBvh () :
+    bounds (),
+    nodes (),
+    triangles ()
+{
+
+}
+
+void BuildBvh (const std::vector<double>& positions, const std::vector<std::uint32_t>& indices, ResultBvh& bvh)
+{
+    bvh = ResultBvh ();
+    if (indices.empty ()) {
+        return;
+    }
+
+    opencascade::handle<BVH_Builder<Standard_Real, 3>> builder = new BVH_BinnedBuilder<Standard_Real, 3> (BvhLeafNodeSize, BvhMaxTreeDepth);
+    opencascade::handle<BVH_Triangulation<Standard_Real, 3>> triangulation = new BVH_Triangulation<Standard_Real, 3> (builder);
+
+    size_t vertexCount = positions.size () / 3;
+    triangulation->Vertices.reserve (vertexCount);
+    for (size_t vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++) {
+        triangulation->Vertices.push_back (BVH_Vec3d (
+            positions[vertexIndex * 3],
+            positions[vertexIndex * 3 + 1],
+            positions[vertexIndex * 3 + 2]
+        ));
+    }
+
+    // the fourth component stores the original triangle index, it moves together with the triangle
+    size_t triangleCount = indices.size () / 3;
+    triangulation->Elements.reserve (triangleCount);
+    for (size_t triangleIndex = 0; triangleIndex < triangleCount; triangleIndex++) {
+        triangulation->Elements.push_back (BVH_Vec4i (
+            (int) indices[triangleIndex * 3],
+            (int) indices[triangleIndex * 3 + 1],
+            (int) indices[triangleIndex * 3 + 2],
+            (int) triangleIndex
+        ));
+    }
+
+    triangulation->MarkDirty ();
+    const opencascade::handle<BVH_Tree<Standard_Real, 3>>& tree = triangulation->BVH ();
+
+    int nodeCount = tree->Length ();
+    bvh.bounds.reserve (nodeCount * 6);
+    bvh.nodes.reserve (nodeCount * 3);
+    for (int nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
+        // round the bounds outwards, so the single precision box still contains the triangles
+        const BVH_Vec3d& minPoint = tree->MinPoint (nodeIndex);
+        const BVH_Vec3d& maxPoint = tree->MaxPoint (nodeIndex);
+        const float lowest = -std::numeric_limits<float>::infinity ();
+        const float highest = std::numeric_limits<float>::infinity ();
+        bvh.bounds.push_back (std::nextafter ((float) minPoint.x (), lowest));
+        bvh.bounds.push_back (std::nextafter ((float) minPoint.y (), lowest));
+        bvh.bounds.push_back (std::nextafter ((float) minPoint.z (), lowest));
+        bvh.bounds.push_back (std::nextafter ((float) maxPoint.x (), highest));
+        bvh.bounds.push_back (std::nextafter ((float) maxPoint.y (), highest));
+        bvh.bounds.push_back (std::nextafter ((float) maxPoint.z (), highest));
+
+        if (tree->IsOuter (nodeIndex)) {
+            bvh.nodes.push_back (1);
+            bvh.nodes.push_back (tree->BegPrimitive (nodeIndex));
+            bvh.nodes.push_back (tree->EndPrimitive (nodeIndex));
+        } else {
+            bvh.nodes.push_back (0);
+            bvh.nodes.push_back (tree->template Child<0> (nodeIndex));
+            bvh.nodes.push_back (tree->template Child<1> (nodeIndex));
+        }
+    }
+
+    bvh.triangles.reserve (triangleCount);
+    for (const BVH_Vec4i& element : triangulation->Elements) {
+        bvh.triangles.push_back ((std::uint32_t) element.w ());
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+class ResultBvh
+{
+public:
+    ResultBvh ();
+
+    // six values per node: minimum and maximum point of the bounding box
+    std::vector<float> bounds;
+    // three values per node: leaf flag, and the two child indices for inner nodes,
+    // or the first and last index in the triangles array (inclusive) for leaves
+    std::vector<std::int32_t> nodes;
+    // triangle indices in the order referenced by the leaves
+    std::vector<std::uint32_t> triangles;
+};
+
+void BuildBvh (const std::vector<double>& positions, const std::vector<std::uint32_t>& indices, ResultBvh& bvh);
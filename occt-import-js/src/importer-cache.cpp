@@ -0,0 +1,223 @@
+#include "importer-cache.hpp"
+
+#include <OSD_Process.hxx>
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <atomic>
+
+static const std::uint64_t HashOffsetBasis = 14695981039346656037ULL;
+static const std::uint64_t HashPrime = 1099511628211ULL;
+// the keys are built from two hashes with different seeds, a collision would return the result of another file
+static const std::uint64_t CacheKeySeeds[2] = { 0x0ULL, 0x9E3779B97F4A7C15ULL };
+
+Hasher::Hasher () :
+    hash (HashOffsetBasis)
+{
+
+}
+
+Hasher::Hasher (std::uint64_t seed) :
+    hash (HashOffsetBasis ^ seed)
+{
+
+}
+
+void Hasher::AddBytes (const std::uint8_t* bytes, size_t size)
+{
+    // hash eight bytes at a time, the content of large files dominates the cost
+    size_t wordCount = size / sizeof (std::uint64_t);
+    for (size_t wordIndex = 0; wordIndex < wordCount; wordIndex++) {
+        std::uint64_t word = 0;
+        std::memcpy (&word, bytes + wordIndex * sizeof (std::uint64_t), sizeof (std::uint64_t));
+        AddWord (word);
+    }
+    for (size_t byteIndex = wordCount * sizeof (std::uint64_t); byteIndex < size; byteIndex++) {
+        AddWord (bytes[byteIndex]);
+    }
+    AddWord (size);
+}
+
+void Hasher::AddByteChunks (const std::vector<std::vector<std::uint8_t>>& chunks)
+{
+    // the hash is the same as the hash of the concatenated chunks, so words can span chunk boundaries
+    std::uint8_t wordBytes[sizeof (std::uint64_t)];
+    size_t wordSize = 0;
+    size_t size = 0;
+    for (const std::vector<std::uint8_t>& chunk : chunks) {
+        size_t offset = 0;
+        while (wordSize > 0 && wordSize < sizeof (std::uint64_t) && offset < chunk.size ()) {
+            wordBytes[wordSize++] = chunk[offset++];
+        }
+        if (wordSize == sizeof (std::uint64_t)) {
+            std::uint64_t word = 0;
+            std::memcpy (&word, wordBytes, sizeof (std::uint64_t));
+            AddWord (word);
+            wordSize = 0;
+        }
+        while (offset + sizeof (std::uint64_t) <= chunk.size ()) {
+            std::uint64_t word = 0;
+            std::memcpy (&word, chunk.data () + offset, sizeof (std::uint64_t));
+            AddWord (word);
+            offset += sizeof (std::uint64_t);
+        }
+        while (offset < chunk.size ()) {
+            wordBytes[wordSize++] = chunk[offset++];
+        }
+        size += chunk.size ();
+    }
+    for (size_t byteIndex = 0; byteIndex < wordSize; byteIndex++) {
+        AddWord (wordBytes[byteIndex]);
+    }
+    AddWord (size);
+}
+
+void Hasher::AddString (const std::string& value)
+{
+    AddBytes ((const std::uint8_t*) value.data (), value.size ());
+}
+
+void Hasher::AddInt (int value)
+{
+    AddWord ((std::uint64_t) value);
+}
+
+void Hasher::AddDouble (double value)
+{
+    std::uint64_t word = 0;
+    std::memcpy (&word, &value, sizeof (double));
+    AddWord (word);
+}
+
+std::string Hasher::GetHexString () const
+{
+    static const char* hexDigits = "0123456789abcdef";
+    std::string result (16, '0');
+    for (int digitIndex = 0; digitIndex < 16; digitIndex++) {
+        result[15 - digitIndex] = hexDigits[(hash >> (digitIndex * 4)) & 0xF];
+    }
+    return result;
+}
+
+void Hasher::AddWord (std::uint64_t word)
+{
+    hash ^= word;
+    hash *= HashPrime;
+    hash ^= (hash >> 32);
+}
+
+void AddImportParams (Hasher& hasher, const ImportParams& params)
+{
+    hasher.AddInt ((int) params.linearUnit);
+    hasher.AddInt ((int) params.linearDeflectionType);
+    hasher.AddDouble (params.linearDeflection);
+    hasher.AddDouble (params.angularDeflection);
+    hasher.AddInt (params.triangleBudget);
+    hasher.AddInt (params.reuseTriangulation ? 1 : 0);
+    hasher.AddDouble (params.decimationRatio);
+    hasher.AddDouble (params.decimationMaxError);
+    hasher.AddInt (params.computeNormals ? 1 : 0);
+    hasher.AddInt (params.deduplicateSolids ? 1 : 0);
+    hasher.AddInt ((int) params.includeNodes.size ());
+    for (const std::string& pattern : params.includeNodes) {
+        hasher.AddString (pattern);
+    }
+    hasher.AddInt ((int) params.excludeNodes.size ());
+    for (const std::string& pattern : params.excludeNodes) {
+        hasher.AddString (pattern);
+    }
+    hasher.AddInt (params.skipHiddenShapes ? 1 : 0);
+    hasher.AddInt ((int) params.includeLayers.size ());
+    for (const std::string& pattern : params.includeLayers) {
+        hasher.AddString (pattern);
+    }
+    hasher.AddInt ((int) params.excludeLayers.size ());
+    for (const std::string& pattern : params.excludeLayers) {
+        hasher.AddString (pattern);
+    }
+}
+
+std::string GetCacheKey (const std::string& format, const std::vector<std::uint8_t>& fileContent, const ImportParams& params)
+{
+    std::string cacheKey;
+    for (std::uint64_t seed : CacheKeySeeds) {
+        Hasher hasher (seed);
+        hasher.AddString (format);
+        AddImportParams (hasher, params);
+        hasher.AddBytes (fileContent.data (), fileContent.size ());
+        cacheKey += hasher.GetHexString ();
+    }
+    return cacheKey;
+}
+
+std::string GetCacheKey (const std::string& format, const std::vector<std::vector<std::uint8_t>>& fileChunks, const ImportParams& params)
+{
+    std::string cacheKey;
+    for (std::uint64_t seed : CacheKeySeeds) {
+        Hasher hasher (seed);
+        hasher.AddString (format);
+        AddImportParams (hasher, params);
+        hasher.AddByteChunks (fileChunks);
+        cacheKey += hasher.GetHexString ();
+    }
+    return cacheKey;
+}
+
+ResultCache::ResultCache (const std::string& folderPath) :
+    folderPath (folderPath)
+{
+
+}
+
+bool ResultCache::Load (const std::string& key, ImportResult& result) const
+{
+    std::ifstream inputStream (GetFilePath (key), std::ios::binary);
+    if (!inputStream.is_open ()) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> data (std::istreambuf_iterator<char> (inputStream), {});
+    std::string storedKey;
+    if (!DeserializeResult (data, storedKey, result)) {
+        return false;
+    }
+    return storedKey == key;
+}
+
+bool ResultCache::Store (const std::string& key, const ImportResult& result) const
+{
+    std::vector<std::uint8_t> data;
+    SerializeResult (result, key, data);
+
+    // write to a temporary file first, so a concurrent reader never sees a partial entry,
+    // and concurrent writers of the same entry don't write the same file
+    static std::atomic<unsigned int> tempFileCounter (0);
+    OSD_Process process;
+    std::string filePath = GetFilePath (key);
+    std::string tempFilePath = filePath + "." + std::to_string (process.ProcessId ()) + "_" + std::to_string (tempFileCounter++) + ".tmp";
+    std::ofstream outputStream (tempFilePath, std::ios::binary);
+    if (!outputStream.is_open ()) {
+        return false;
+    }
+    outputStream.write ((const char*) data.data (), data.size ());
+    outputStream.close ();
+    if (!outputStream) {
+        std::remove (tempFilePath.c_str ());
+        return false;
+    }
+
+    // rename fails on windows if another writer has just stored the same entry
+    std::remove (filePath.c_str ());
+    if (std::rename (tempFilePath.c_str (), filePath.c_str ()) != 0) {
+        std::remove (tempFilePath.c_str ());
+        return false;
+    }
+    return true;
+}
+
+std::string ResultCache::GetFilePath (const std::string& key) const
+{
+    return folderPath + "/" + key + ".oijc";
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "importer.hpp"
+#include "importer-result.hpp"
+
+class Hasher
+{
+public:
+    Hasher ();
+    Hasher (std::uint64_t seed);
+
+    void AddBytes (const std::uint8_t* bytes, size_t size);
+    void AddByteChunks (const std::vector<std::vector<std::uint8_t>>& chunks);
+    void AddString (const std::string& value);
+    void AddInt (int value);
+    void AddDouble (double value);
+
+    std::string GetHexString () const;
+
+private:
+    void AddWord (std::uint64_t word);
+
+    std::uint64_t hash;
+};
+
+void AddImportParams (Hasher& hasher, const ImportParams& params);
+std::string GetCacheKey (const std::string& format, const std::vector<std::uint8_t>& fileContent, const ImportParams& params);
+std::string GetCacheKey (const std::string& format, const std::vector<std::vector<std::uint8_t>>& fileChunks, const ImportParams& params);
+
+class ResultCache
+{
+public:
+    ResultCache (const std::string& folderPath);
+
+    bool Load (const std::string& key, ImportResult& result) const;
+    bool Store (const std::string& key, const ImportResult& result) const;
+
+private:
+    std::string GetFilePath (const std::string& key) const;
+
+    std::string folderPath;
+};
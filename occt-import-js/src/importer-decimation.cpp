@@ -0,0 +1,424 @@
+#include "importer-decimation.hpp"
+
+#include <cmath>
+#include <queue>
+#include <map>
+#include <algorithm>
+
+// the cosine of the maximal normal rotation of a triangle caused by a collapse
+static const double MinNormalCosine = 0.2;
+
+class Vector3
+{
+public:
+    Vector3 () :
+        x (0.0),
+        y (0.0),
+        z (0.0)
+    {
+
+    }
+
+    Vector3 (double x, double y, double z) :
+        x (x),
+        y (y),
+        z (z)
+    {
+
+    }
+
+    Vector3 operator- (const Vector3& other) const
+    {
+        return Vector3 (x - other.x, y - other.y, z - other.z);
+    }
+
+    double Dot (const Vector3& other) const
+    {
+        return x * other.x + y * other.y + z * other.z;
+    }
+
+    Vector3 Cross (const Vector3& other) const
+    {
+        return Vector3 (y * other.z - z * other.y, z * other.x - x * other.z, x * other.y - y * other.x);
+    }
+
+    double Length () const
+    {
+        return std::sqrt (Dot (*this));
+    }
+
+    double x;
+    double y;
+    double z;
+};
+
+class Quadric
+{
+public:
+    Quadric ()
+    {
+        std::fill (values, values + 10, 0.0);
+    }
+
+    Quadric (const Vector3& normal, double d)
+    {
+        values[0] = normal.x * normal.x;
+        values[1] = normal.x * normal.y;
+        values[2] = normal.x * normal.z;
+        values[3] = normal.x * d;
+        values[4] = normal.y * normal.y;
+        values[5] = normal.y * normal.z;
+        values[6] = normal.y * d;
+        values[7] = normal.z * normal.z;
+        values[8] = normal.z * d;
+        values[9] = d * d;
+    }
+
+    void Add (const Quadric& other)
+    {
+        for (int i = 0; i < 10; i++) {
+            values[i] += other.values[i];
+        }
+    }
+
+    double Evaluate (const Vector3& p) const
+    {
+        // sum of squared distances from the planes of the quadric
+        return values[0] * p.x * p.x + 2.0 * values[1] * p.x * p.y + 2.0 * values[2] * p.x * p.z + 2.0 * values[3] * p.x +
+            values[4] * p.y * p.y + 2.0 * values[5] * p.y * p.z + 2.0 * values[6] * p.y +
+            values[7] * p.z * p.z + 2.0 * values[8] * p.z +
+            values[9];
+    }
+
+private:
+    double values[10];
+};
+
+class Collapse
+{
+public:
+    Collapse (double cost, int from, int to, int fromStamp, int toStamp) :
+        cost (cost),
+        from (from),
+        to (to),
+        fromStamp (fromStamp),
+        toStamp (toStamp)
+    {
+
+    }
+
+    bool operator> (const Collapse& other) const
+    {
+        return cost > other.cost;
+    }
+
+    double cost;
+    int from;
+    int to;
+    int fromStamp;
+    int toStamp;
+};
+
+class Decimator
+{
+public:
+    Decimator (ResultMesh& mesh) :
+        mesh (mesh),
+        vertexCount ((int) (mesh.positions.size () / 3)),
+        triangleCount ((int) (mesh.indices.size () / 3)),
+        aliveTriangleCount (triangleCount),
+        positions (vertexCount),
+        quadrics (vertexCount),
+        vertexTriangles (vertexCount),
+        isLocked (vertexCount, false),
+        stamps (vertexCount, 0),
+        isTriangleAlive (triangleCount, true),
+        queue ()
+    {
+        for (int vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++) {
+            positions[vertexIndex] = Vector3 (
+                mesh.positions[vertexIndex * 3],
+                mesh.positions[vertexIndex * 3 + 1],
+                mesh.positions[vertexIndex * 3 + 2]
+            );
+        }
+    }
+
+    void Decimate (double targetRatio, double maxError)
+    {
+        int targetTriangleCount = (int) std::ceil (triangleCount * targetRatio);
+        double maxCost = (maxError > 0.0 ? maxError * maxError : -1.0);
+
+        InitTopology ();
+        InitQuadrics ();
+        for (int vertexIndex = 0; vertexIndex < vertexCount; vertexIndex++) {
+            AddCollapses (vertexIndex);
+        }
+
+        while (aliveTriangleCount > targetTriangleCount && !queue.empty ()) {
+            Collapse collapse = queue.top ();
+            queue.pop ();
+            if (collapse.fromStamp != stamps[collapse.from] || collapse.toStamp != stamps[collapse.to]) {
+                continue;
+            }
+            if (maxCost >= 0.0 && collapse.cost > maxCost) {
+                break;
+            }
+            if (!IsCollapseValid (collapse.from, collapse.to)) {
+                continue;
+            }
+            ApplyCollapse (collapse.from, collapse.to);
+        }
+
+        Compact ();
+    }
+
+private:
+    void InitTopology ()
+    {
+        // edges used by only one triangle are on the boundary of a brep face (faces don't share
+        // vertices), edges used by more than two triangles are non-manifold, both of them are locked
+        std::map<std::pair<int, int>, int> edgeUsage;
+        for (int triangleIndex = 0; triangleIndex < triangleCount; triangleIndex++) {
+            for (int corner = 0; corner < 3; corner++) {
+                int v0 = GetTriangleVertex (triangleIndex, corner);
+                int v1 = GetTriangleVertex (triangleIndex, (corner + 1) % 3);
+                edgeUsage[std::make_pair (std::min (v0, v1), std::max (v0, v1))] += 1;
+                vertexTriangles[v0].push_back (triangleIndex);
+            }
+        }
+        for (const auto& it : edgeUsage) {
+            if (it.second != 2) {
+                isLocked[it.first.first] = true;
+                isLocked[it.first.second] = true;
+            }
+        }
+    }
+
+    void InitQuadrics ()
+    {
+        for (int triangleIndex = 0; triangleIndex < triangleCount; triangleIndex++) {
+            Vector3 normal = GetTriangleNormal (triangleIndex, -1, -1);
+            double length = normal.Length ();
+            if (length <= 0.0) {
+                continue;
+            }
+            normal = Vector3 (normal.x / length, normal.y / length, normal.z / length);
+            const Vector3& p0 = positions[GetTriangleVertex (triangleIndex, 0)];
+            Quadric quadric (normal, -normal.Dot (p0));
+            for (int corner = 0; corner < 3; corner++) {
+                quadrics[GetTriangleVertex (triangleIndex, corner)].Add (quadric);
+            }
+        }
+    }
+
+    void AddCollapses (int vertexIndex)
+    {
+        std::vector<int> neighbors;
+        GetNeighbors (vertexIndex, neighbors);
+        for (int neighbor : neighbors) {
+            AddCollapse (vertexIndex, neighbor);
+            AddCollapse (neighbor, vertexIndex);
+        }
+    }
+
+    void AddCollapse (int from, int to)
+    {
+        if (isLocked[from]) {
+            return;
+        }
+        // the collapsed vertex is moved to the other one, so normals and other attributes remain valid
+        Quadric quadric = quadrics[from];
+        quadric.Add (quadrics[to]);
+        double cost = quadric.Evaluate (positions[to]);
+        queue.push (Collapse (cost, from, to, stamps[from], stamps[to]));
+    }
+
+    bool IsCollapseValid (int from, int to) const
+    {
+        std::vector<int> fromNeighbors;
+        std::vector<int> toNeighbors;
+        GetNeighbors (from, fromNeighbors);
+        GetNeighbors (to, toNeighbors);
+
+        // link condition: the common neighbors must be the opposite vertices of the collapsed triangles
+        int sharedTriangleCount = 0;
+        for (int triangleIndex : vertexTriangles[from]) {
+            if (isTriangleAlive[triangleIndex] && HasVertex (triangleIndex, to)) {
+                sharedTriangleCount += 1;
+            }
+        }
+        if (sharedTriangleCount == 0) {
+            return false;
+        }
+        int commonNeighborCount = 0;
+        for (int neighbor : fromNeighbors) {
+            if (std::find (toNeighbors.begin (), toNeighbors.end (), neighbor) != toNeighbors.end ()) {
+                commonNeighborCount += 1;
+            }
+        }
+        if (commonNeighborCount != sharedTriangleCount) {
+            return false;
+        }
+
+        // the remaining triangles must not flip or degenerate
+        for (int triangleIndex : vertexTriangles[from]) {
+            if (!isTriangleAlive[triangleIndex] || HasVertex (triangleIndex, to)) {
+                continue;
+            }
+            Vector3 oldNormal = GetTriangleNormal (triangleIndex, -1, -1);
+            Vector3 newNormal = GetTriangleNormal (triangleIndex, from, to);
+            double oldLength = oldNormal.Length ();
+            double newLength = newNormal.Length ();
+            if (newLength <= 0.0) {
+                return false;
+            }
+            if (oldLength > 0.0 && oldNormal.Dot (newNormal) < MinNormalCosine * oldLength * newLength) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void ApplyCollapse (int from, int to)
+    {
+        for (int triangleIndex : vertexTriangles[from]) {
+            if (!isTriangleAlive[triangleIndex]) {
+                continue;
+            }
+            if (HasVertex (triangleIndex, to)) {
+                isTriangleAlive[triangleIndex] = false;
+                aliveTriangleCount -= 1;
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                if (GetTriangleVertex (triangleIndex, corner) == from) {
+                    mesh.indices[triangleIndex * 3 + corner] = to;
+                }
+            }
+            vertexTriangles[to].push_back (triangleIndex);
+        }
+        vertexTriangles[from].clear ();
+        quadrics[to].Add (quadrics[from]);
+
+        std::vector<int> neighbors;
+        GetNeighbors (to, neighbors);
+        stamps[from] += 1;
+        stamps[to] += 1;
+        for (int neighbor : neighbors) {
+            stamps[neighbor] += 1;
+        }
+        AddCollapses (to);
+        for (int neighbor : neighbors) {
+            AddCollapses (neighbor);
+        }
+    }
+
+    void Compact ()
+    {
+        bool hasNormals = (mesh.normals.size () == mesh.positions.size ());
+        std::vector<int> newVertexIndices (vertexCount, -1);
+        std::vector<double> newPositions;
+        std::vector<double> newNormals;
+        std::vector<std::uint32_t> newIndices;
+        std::vector<int> newTriangleOffsets (triangleCount + 1, 0);
+
+        for (int triangleIndex = 0; triangleIndex < triangleCount; triangleIndex++) {
+            newTriangleOffsets[triangleIndex + 1] = newTriangleOffsets[triangleIndex];
+            if (!isTriangleAlive[triangleIndex]) {
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                int vertexIndex = GetTriangleVertex (triangleIndex, corner);
+                if (newVertexIndices[vertexIndex] == -1) {
+                    newVertexIndices[vertexIndex] = (int) (newPositions.size () / 3);
+                    newPositions.insert (newPositions.end (), mesh.positions.begin () + vertexIndex * 3, mesh.positions.begin () + vertexIndex * 3 + 3);
+                    if (hasNormals) {
+                        newNormals.insert (newNormals.end (), mesh.normals.begin () + vertexIndex * 3, mesh.normals.begin () + vertexIndex * 3 + 3);
+                    }
+                }
+                newIndices.push_back (newVertexIndices[vertexIndex]);
+            }
+            newTriangleOffsets[triangleIndex + 1] += 1;
+        }
+
+        for (ResultBrepFace& brepFace : mesh.brepFaces) {
+            int first = newTriangleOffsets[brepFace.first];
+            int last = newTriangleOffsets[brepFace.last + 1] - 1;
+            brepFace.first = first;
+            brepFace.last = last;
+        }
+
+        mesh.positions.swap (newPositions);
+        if (hasNormals) {
+            mesh.normals.swap (newNormals);
+        }
+        mesh.indices.swap (newIndices);
+    }
+
+    void GetNeighbors (int vertexIndex, std::vector<int>& neighbors) const
+    {
+        for (int triangleIndex : vertexTriangles[vertexIndex]) {
+            if (!isTriangleAlive[triangleIndex]) {
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                int neighbor = GetTriangleVertex (triangleIndex, corner);
+                if (neighbor != vertexIndex && std::find (neighbors.begin (), neighbors.end (), neighbor) == neighbors.end ()) {
+                    neighbors.push_back (neighbor);
+                }
+            }
+        }
+    }
+
+    int GetTriangleVertex (int triangleIndex, int corner) const
+    {
+        return (int) mesh.indices[triangleIndex * 3 + corner];
+    }
+
+    bool HasVertex (int triangleIndex, int vertexIndex) const
+    {
+        for (int corner = 0; corner < 3; corner++) {
+            if (GetTriangleVertex (triangleIndex, corner) == vertexIndex) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Vector3 GetTriangleNormal (int triangleIndex, int replacedVertex, int newVertex) const
+    {
+        Vector3 corners[3];
+        for (int corner = 0; corner < 3; corner++) {
+            int vertexIndex = GetTriangleVertex (triangleIndex, corner);
+            corners[corner] = positions[vertexIndex == replacedVertex ? newVertex : vertexIndex];
+        }
+        return (corners[1] - corners[0]).Cross (corners[2] - corners[0]);
+    }
+
+    ResultMesh& mesh;
+    int vertexCount;
+    int triangleCount;
+    int aliveTriangleCount;
+
+    std::vector<Vector3> positions;
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<int>> vertexTriangles;
+    std::vector<bool> isLocked;
+    std::vector<int> stamps;
+    std::vector<bool> isTriangleAlive;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+};
+
+void DecimateMesh (ResultMesh& mesh, double targetRatio, double maxError)
+{
+    if ((targetRatio >= 1.0 && maxError <= 0.0) || mesh.indices.empty ()) {
+        return;
+    }
+
+    // if only the error is given, it alone stops the simplification
+    double ratio = (targetRatio >= 1.0 ? 0.0 : std::max (targetRatio, 0.0));
+    Decimator decimator (mesh);
+    decimator.Decimate (ratio, maxError);
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+#include "importer-result.hpp"
+
+void DecimateMesh (ResultMesh& mesh, double targetRatio, double maxError);
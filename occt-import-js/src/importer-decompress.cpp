@@ -0,0 +1,247 @@
+#include "importer-decompress.hpp"
+
+#ifdef OCCTIMPORTJS_ZLIB
+
+#include <zlib.h>
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+static const size_t DecompressBufferSize = 65536;
+
+static std::uint16_t ReadUInt16 (const unsigned char* bytes)
+{
+    return (std::uint16_t) (bytes[0] | (bytes[1] << 8));
+}
+
+static std::uint32_t ReadUInt32 (const unsigned char* bytes)
+{
+    return (std::uint32_t) bytes[0] | ((std::uint32_t) bytes[1] << 8) | ((std::uint32_t) bytes[2] << 16) | ((std::uint32_t) bytes[3] << 24);
+}
+
+class DecompressBuffer : public std::streambuf
+{
+public:
+    enum class Mode
+    {
+        Plain,
+        Stored,
+        Inflate
+    };
+
+    DecompressBuffer (std::streambuf* source) :
+        source (source),
+        mode (Mode::Plain),
+        zStream (),
+        zStreamInitialized (false),
+        inBuffer (DecompressBufferSize),
+        outBuffer (DecompressBufferSize),
+        prefixSize (0),
+        storedRemaining (0),
+        finished (false),
+        failed (false)
+    {
+
+    }
+
+    virtual ~DecompressBuffer ()
+    {
+        if (zStreamInitialized) {
+            inflateEnd (&zStream);
+        }
+    }
+
+    bool Init ()
+    {
+        unsigned char signature[4] = { 0, 0, 0, 0 };
+        std::streamsize signatureSize = source->sgetn ((char*) signature, 4);
+        if (signatureSize >= 2 && signature[0] == 0x1F && signature[1] == 0x8B) {
+            // gzip header is processed by zlib
+            return InitInflate (16 + MAX_WBITS, signature, (size_t) signatureSize);
+        }
+        if (signatureSize >= 2 && signature[0] == 0x78 && (signature[0] * 256 + signature[1]) % 31 == 0) {
+            return InitInflate (MAX_WBITS, signature, (size_t) signatureSize);
+        }
+        if (signatureSize == 4 && ReadUInt32 (signature) == 0x04034B50) {
+            return InitZipEntry ();
+        }
+
+        // not compressed, the signature bytes are returned first
+        mode = Mode::Plain;
+        std::memcpy (inBuffer.data (), signature, (size_t) signatureSize);
+        prefixSize = (size_t) signatureSize;
+        return true;
+    }
+
+    bool IsComplete () const
+    {
+        // a corrupt or truncated compressed stream looks like the end of the content to the reader
+        switch (mode) {
+            case Mode::Plain:
+                return true;
+            case Mode::Stored:
+                return storedRemaining == 0;
+            case Mode::Inflate:
+                return finished && !failed;
+        }
+        return false;
+    }
+
+protected:
+    virtual int_type underflow () override
+    {
+        if (gptr () < egptr ()) {
+            return traits_type::to_int_type (*gptr ());
+        }
+
+        size_t outSize = 0;
+        switch (mode) {
+            case Mode::Plain:
+                outSize = ReadPlain ();
+                break;
+            case Mode::Stored:
+                outSize = ReadStored ();
+                break;
+            case Mode::Inflate:
+                outSize = ReadInflate ();
+                break;
+        }
+
+        if (outSize == 0) {
+            return traits_type::eof ();
+        }
+        setg (outBuffer.data (), outBuffer.data (), outBuffer.data () + outSize);
+        return traits_type::to_int_type (*gptr ());
+    }
+
+private:
+    bool InitInflate (int windowBits, const unsigned char* prefix, size_t size)
+    {
+        std::memset (&zStream, 0, sizeof (zStream));
+        if (inflateInit2 (&zStream, windowBits) != Z_OK) {
+            return false;
+        }
+        zStreamInitialized = true;
+        std::memcpy (inBuffer.data (), prefix, size);
+        zStream.next_in = (Bytef*) inBuffer.data ();
+        zStream.avail_in = (uInt) size;
+        mode = Mode::Inflate;
+        return true;
+    }
+
+    bool InitZipEntry ()
+    {
+        // the rest of the local file header after the signature
+        unsigned char header[26];
+        if (source->sgetn ((char*) header, 26) != 26) {
+            return false;
+        }
+        std::uint16_t flags = ReadUInt16 (header + 2);
+        std::uint16_t method = ReadUInt16 (header + 4);
+        std::uint32_t compressedSize = ReadUInt32 (header + 14);
+        std::uint16_t nameLength = ReadUInt16 (header + 22);
+        std::uint16_t extraLength = ReadUInt16 (header + 24);
+        for (size_t i = 0; i < (size_t) nameLength + extraLength; i++) {
+            if (source->sbumpc () == traits_type::eof ()) {
+                return false;
+            }
+        }
+
+        if (method == 8) {
+            return InitInflate (-MAX_WBITS, nullptr, 0);
+        }
+        // stored entries can be read only if the size is known before the data
+        bool hasDataDescriptor = (flags & 0x08) != 0;
+        if (method == 0 && !hasDataDescriptor) {
+            mode = Mode::Stored;
+            storedRemaining = compressedSize;
+            return true;
+        }
+        return false;
+    }
+
+    size_t ReadPlain ()
+    {
+        if (prefixSize > 0) {
+            std::memcpy (outBuffer.data (), inBuffer.data (), prefixSize);
+            size_t outSize = prefixSize;
+            prefixSize = 0;
+            return outSize;
+        }
+        return (size_t) source->sgetn (outBuffer.data (), outBuffer.size ());
+    }
+
+    size_t ReadStored ()
+    {
+        size_t readSize = std::min (storedRemaining, outBuffer.size ());
+        size_t outSize = (size_t) source->sgetn (outBuffer.data (), readSize);
+        storedRemaining -= outSize;
+        return outSize;
+    }
+
+    size_t ReadInflate ()
+    {
+        zStream.next_out = (Bytef*) outBuffer.data ();
+        zStream.avail_out = (uInt) outBuffer.size ();
+        while (!finished && zStream.avail_out == outBuffer.size ()) {
+            if (zStream.avail_in == 0) {
+                std::streamsize readSize = source->sgetn (inBuffer.data (), inBuffer.size ());
+                if (readSize <= 0) {
+                    finished = true;
+                    failed = true;
+                    break;
+                }
+                zStream.next_in = (Bytef*) inBuffer.data ();
+                zStream.avail_in = (uInt) readSize;
+            }
+            int status = inflate (&zStream, Z_NO_FLUSH);
+            if (status == Z_STREAM_END) {
+                finished = true;
+            } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                finished = true;
+                failed = true;
+            }
+        }
+        return outBuffer.size () - zStream.avail_out;
+    }
+
+    std::streambuf* source;
+    Mode mode;
+    z_stream zStream;
+    bool zStreamInitialized;
+    std::vector<char> inBuffer;
+    std::vector<char> outBuffer;
+    size_t prefixSize;
+    size_t storedRemaining;
+    bool finished;
+    bool failed;
+};
+
+bool ReadDecompressedStream (std::istream& inputStream, const std::function<bool (std::istream&)>& onStream)
+{
+    DecompressBuffer decompressBuffer (inputStream.rdbuf ());
+    if (!decompressBuffer.Init ()) {
+        return false;
+    }
+    std::istream decompressedStream (&decompressBuffer);
+    if (!onStream (decompressedStream)) {
+        return false;
+    }
+
+    // the reader can stop before the end, but the content is valid only if the whole stream is
+    decompressedStream.clear ();
+    decompressedStream.ignore (std::numeric_limits<std::streamsize>::max ());
+    return decompressBuffer.IsComplete ();
+}
+
+#else
+
+bool ReadDecompressedStream (std::istream& inputStream, const std::function<bool (std::istream&)>& onStream)
+{
+    return onStream (inputStream);
+}
+
+#endif
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <istream>
+#include <functional>
+
+// Calls the function with the decompressed content of the stream if it is compressed (gzip, zlib,
+// or the first entry of a zip file), otherwise with the stream itself. The decompressed content
+// is produced while the function reads the stream, so it is never stored in one buffer. Returns
+// false if the function fails, or if the compressed stream is corrupt or truncated.
+bool ReadDecompressedStream (std::istream& inputStream, const std::function<bool (std::istream&)>& onStream);
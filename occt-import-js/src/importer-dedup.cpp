@@ -0,0 +1,378 @@
+#include "importer-dedup.hpp"
+#include "importer-reuse.hpp"
+
+#include <TopExp_Explorer.hxx>
+#include <TopoDS.hxx>
+#include <TopoDS_Compound.hxx>
+#include <BRep_Tool.hxx>
+#include <BRep_Builder.hxx>
+#include <BRepTools.hxx>
+#include <BRepAdaptor_Surface.hxx>
+#include <Geom_Surface.hxx>
+#include <Geom_Curve.hxx>
+#include <Poly_Triangulation.hxx>
+#include <Precision.hxx>
+#include <gp_Ax3.hxx>
+
+#include <algorithm>
+#include <cmath>
+
+// distances are rounded to this value in the signature, the exact comparison is done later
+static const Standard_Real SignatureQuantum = 1.0e-4;
+static const std::size_t SignatureDistanceCount = 16;
+static const Standard_Real RelativeTolerance = 1.0e-6;
+// surfaces and curves are compared at this many parameter values in every direction
+static const int GeometrySampleCount = 5;
+
+static void CombineHash (std::size_t& hash, std::size_t value)
+{
+    hash ^= value + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+}
+
+static bool GetDedupSolid (const TopoDS_Shape& solid, DedupSolid& dedupSolid, std::size_t& signature)
+{
+    signature = 0;
+    for (TopExp_Explorer faceEx (solid, TopAbs_FACE); faceEx.More (); faceEx.Next ()) {
+        const TopoDS_Face& face = TopoDS::Face (faceEx.Current ());
+        TopLoc_Location location;
+        const Handle (Geom_Surface)& surface = BRep_Tool::Surface (face, location);
+        if (surface.IsNull ()) {
+            // faces without surface are not triangulated, they keep their own triangulation
+            return false;
+        }
+
+        std::size_t firstPoint = dedupSolid.points.size ();
+        for (TopExp_Explorer vertexEx (face, TopAbs_VERTEX); vertexEx.More (); vertexEx.Next ()) {
+            dedupSolid.points.push_back (BRep_Tool::Pnt (TopoDS::Vertex (vertexEx.Current ())));
+        }
+
+        std::size_t faceSignature = std::hash<const void*> () (surface->DynamicType ().get ());
+        CombineHash (faceSignature, dedupSolid.points.size () - firstPoint);
+        CombineHash (signature, faceSignature);
+        dedupSolid.faces.push_back (face);
+        dedupSolid.faceSignatures.push_back (faceSignature);
+    }
+
+    for (TopExp_Explorer edgeEx (solid, TopAbs_EDGE); edgeEx.More (); edgeEx.Next ()) {
+        dedupSolid.edges.push_back (TopoDS::Edge (edgeEx.Current ()));
+    }
+
+    const std::vector<gp_Pnt>& points = dedupSolid.points;
+    if (points.empty ()) {
+        return false;
+    }
+
+    Standard_Real size = 0.0;
+    for (const gp_Pnt& point : points) {
+        size = std::max (size, point.Distance (points[0]));
+    }
+    dedupSolid.tolerance = Precision::Confusion () + size * RelativeTolerance;
+
+    // the distance of consecutive vertices doesn't depend on the placement of the solid
+    for (std::size_t pointIndex = 1; pointIndex < points.size () && pointIndex <= SignatureDistanceCount; pointIndex++) {
+        Standard_Real distance = points[pointIndex].Distance (points[pointIndex - 1]);
+        CombineHash (signature, (std::size_t) std::llround (distance / SignatureQuantum));
+    }
+    return true;
+}
+
+static bool GetAxes (const std::vector<gp_Pnt>& points, std::size_t second, std::size_t third, Standard_Real tolerance, gp_Ax3& axes)
+{
+    gp_Vec xDirection (points[0], points[second]);
+    gp_Vec normal = xDirection.Crossed (gp_Vec (points[0], points[third]));
+    if (xDirection.Magnitude () <= tolerance || normal.Magnitude () <= tolerance * xDirection.Magnitude ()) {
+        return false;
+    }
+    axes = gp_Ax3 (points[0], gp_Dir (normal), gp_Dir (xDirection));
+    return true;
+}
+
+static bool GetTransformation (const DedupSolid& prototype, const DedupSolid& solid, gp_Trsf& transformation)
+{
+    // the vertices are in the same order in both solids, so three vertices that are not
+    // on one line define the transformation, and all the others must fit to it
+    const std::vector<gp_Pnt>& points = prototype.points;
+    std::size_t second = 0;
+    std::size_t third = 0;
+    for (std::size_t pointIndex = 1; pointIndex < points.size () && third == 0; pointIndex++) {
+        if (second == 0) {
+            if (points[pointIndex].Distance (points[0]) > prototype.tolerance) {
+                second = pointIndex;
+            }
+        } else {
+            gp_Vec xDirection (points[0], points[second]);
+            gp_Vec normal = xDirection.Crossed (gp_Vec (points[0], points[pointIndex]));
+            if (normal.Magnitude () > prototype.tolerance * xDirection.Magnitude ()) {
+                third = pointIndex;
+            }
+        }
+    }
+    if (third == 0) {
+        return false;
+    }
+
+    gp_Ax3 prototypeAxes;
+    gp_Ax3 solidAxes;
+    if (!GetAxes (prototype.points, second, third, prototype.tolerance, prototypeAxes) || !GetAxes (solid.points, second, third, solid.tolerance, solidAxes)) {
+        return false;
+    }
+    transformation.SetDisplacement (prototypeAxes, solidAxes);
+
+    for (std::size_t pointIndex = 0; pointIndex < points.size (); pointIndex++) {
+        if (points[pointIndex].Transformed (transformation).Distance (solid.points[pointIndex]) > solid.tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static Standard_Real GetSampleParameter (Standard_Real first, Standard_Real last, int sampleIndex)
+{
+    return first + (last - first) * sampleIndex / (GeometrySampleCount - 1);
+}
+
+static bool IsSameFaceGeometry (const TopoDS_Face& prototypeFace, const TopoDS_Face& face, const gp_Trsf& transformation, Standard_Real tolerance)
+{
+    // the vertices can be the same for different surfaces (e.g. cylinders with different radius),
+    // so the surfaces are compared on a grid of their parameter ranges
+    Standard_Real prototypeBounds[4];
+    Standard_Real bounds[4];
+    BRepTools::UVBounds (prototypeFace, prototypeBounds[0], prototypeBounds[1], prototypeBounds[2], prototypeBounds[3]);
+    BRepTools::UVBounds (face, bounds[0], bounds[1], bounds[2], bounds[3]);
+    BRepAdaptor_Surface prototypeSurface (prototypeFace);
+    BRepAdaptor_Surface surface (face);
+    for (int uIndex = 0; uIndex < GeometrySampleCount; uIndex++) {
+        for (int vIndex = 0; vIndex < GeometrySampleCount; vIndex++) {
+            gp_Pnt prototypePoint = prototypeSurface.Value (
+                GetSampleParameter (prototypeBounds[0], prototypeBounds[1], uIndex),
+                GetSampleParameter (prototypeBounds[2], prototypeBounds[3], vIndex)
+            );
+            gp_Pnt point = surface.Value (
+                GetSampleParameter (bounds[0], bounds[1], uIndex),
+                GetSampleParameter (bounds[2], bounds[3], vIndex)
+            );
+            if (prototypePoint.Transformed (transformation).Distance (point) > tolerance) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static bool GetEdgeSamples (const TopoDS_Edge& edge, std::vector<gp_Pnt>& samples)
+{
+    TopLoc_Location location;
+    Standard_Real first = 0.0;
+    Standard_Real last = 0.0;
+    const Handle (Geom_Curve)& curve = BRep_Tool::Curve (edge, location, first, last);
+    if (curve.IsNull ()) {
+        return false;
+    }
+    // the samples follow the orientation of the edge, not the direction of the curve
+    bool isReversed = (edge.Orientation () == TopAbs_REVERSED);
+    for (int sampleIndex = 0; sampleIndex < GeometrySampleCount; sampleIndex++) {
+        Standard_Real parameter = GetSampleParameter (first, last, isReversed ? GeometrySampleCount - 1 - sampleIndex : sampleIndex);
+        samples.push_back (curve->Value (parameter).Transformed (location.Transformation ()));
+    }
+    return true;
+}
+
+static bool IsSameEdgeGeometry (const TopoDS_Edge& prototypeEdge, const TopoDS_Edge& edge, const gp_Trsf& transformation, Standard_Real tolerance)
+{
+    std::vector<gp_Pnt> prototypeSamples;
+    std::vector<gp_Pnt> samples;
+    bool hasPrototypeCurve = GetEdgeSamples (prototypeEdge, prototypeSamples);
+    bool hasCurve = GetEdgeSamples (edge, samples);
+    if (hasPrototypeCurve != hasCurve) {
+        return false;
+    }
+    for (std::size_t sampleIndex = 0; sampleIndex < samples.size (); sampleIndex++) {
+        if (prototypeSamples[sampleIndex].Transformed (transformation).Distance (samples[sampleIndex]) > tolerance) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool IsSameGeometry (const DedupSolid& prototype, const DedupSolid& solid, const gp_Trsf& transformation)
+{
+    for (std::size_t faceIndex = 0; faceIndex < prototype.faces.size (); faceIndex++) {
+        if (!IsSameFaceGeometry (prototype.faces[faceIndex], solid.faces[faceIndex], transformation, solid.tolerance)) {
+            return false;
+        }
+    }
+    for (std::size_t edgeIndex = 0; edgeIndex < prototype.edges.size (); edgeIndex++) {
+        if (!IsSameEdgeGeometry (prototype.edges[edgeIndex], solid.edges[edgeIndex], transformation, solid.tolerance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool IsSameSolid (const DedupSolid& prototype, const DedupSolid& solid, gp_Trsf& transformation)
+{
+    if (prototype.faceSignatures != solid.faceSignatures || prototype.points.size () != solid.points.size () || prototype.edges.size () != solid.edges.size ()) {
+        return false;
+    }
+
+    // the triangulation is stored in the face, so faces shared by the two solids can't be transferred
+    for (std::size_t faceIndex = 0; faceIndex < prototype.faces.size (); faceIndex++) {
+        if (prototype.faces[faceIndex].TShape () == solid.faces[faceIndex].TShape ()) {
+            return false;
+        }
+    }
+
+    // the vertices define the transformation, but only the whole geometry proves that the solids are the same
+    return GetTransformation (prototype, solid, transformation) && IsSameGeometry (prototype, solid, transformation);
+}
+
+static void TransferTriangulation (const TopoDS_Face& source, const TopoDS_Face& target, const gp_Trsf& transformation)
+{
+    TopLoc_Location sourceLocation;
+    const Handle (Poly_Triangulation)& sourceTriangulation = BRep_Tool::Triangulation (source, sourceLocation);
+    if (sourceTriangulation.IsNull ()) {
+        return;
+    }
+
+    // from the local system of the source face to the local system of the target face
+    gp_Trsf nodeTransformation = target.Location ().Transformation ().Inverted () * transformation * sourceLocation.Transformation ();
+    bool isReversed = (source.Orientation () != target.Orientation ());
+    bool hasNormals = sourceTriangulation->HasNormals ();
+
+    Handle (Poly_Triangulation) triangulation = new Poly_Triangulation (
+        sourceTriangulation->NbNodes (), sourceTriangulation->NbTriangles (), Standard_False, hasNormals
+    );
+    for (Standard_Integer nodeIndex = 1; nodeIndex <= sourceTriangulation->NbNodes (); nodeIndex++) {
+        triangulation->SetNode (nodeIndex, sourceTriangulation->Node (nodeIndex).Transformed (nodeTransformation));
+        if (hasNormals) {
+            gp_Dir normal = sourceTriangulation->Normal (nodeIndex).Transformed (nodeTransformation);
+            triangulation->SetNormal (nodeIndex, isReversed ? normal.Reversed () : normal);
+        }
+    }
+    for (Standard_Integer triangleIndex = 1; triangleIndex <= sourceTriangulation->NbTriangles (); triangleIndex++) {
+        Poly_Triangle triangle = sourceTriangulation->Triangle (triangleIndex);
+        if (isReversed) {
+            triangulation->SetTriangle (triangleIndex, Poly_Triangle (triangle (1), triangle (3), triangle (2)));
+        } else {
+            triangulation->SetTriangle (triangleIndex, triangle);
+        }
+    }
+    triangulation->Deflection (sourceTriangulation->Deflection ());
+
+    BRep_Builder builder;
+    builder.UpdateFace (target, triangulation);
+}
+
+DedupSolid::DedupSolid () :
+    faces (),
+    faceSignatures (),
+    edges (),
+    points (),
+    tolerance (0.0)
+{
+
+}
+
+DedupInstance::DedupInstance () :
+    prototype (-1),
+    faces (),
+    transformation ()
+{
+
+}
+
+SolidDeduplicator::SolidDeduplicator (const ImportParams& params) :
+    enabled (
+        params.deduplicateSolids &&
+        params.linearDeflectionType != ImportParams::LinearDeflectionType::TriangleBudget &&
+        (params.meshReuse == nullptr || !params.meshReuse->HasPreviousMeshes ())
+    ),
+    prototypes (),
+    prototypesBySignature (),
+    duplicates (),
+    visitedSolids (),
+    duplicateSolids ()
+{
+
+}
+
+void SolidDeduplicator::AddShape (const TopoDS_Shape& shape)
+{
+    if (!enabled) {
+        return;
+    }
+
+    for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        AddSolid (ex.Current ());
+    }
+}
+
+bool SolidDeduplicator::IsDuplicate (const TopoDS_Shape& solid) const
+{
+    return duplicateSolids.find (solid.TShape ().get ()) != duplicateSolids.end ();
+}
+
+TopoDS_Shape SolidDeduplicator::RemoveDuplicates (const TopoDS_Shape& shape) const
+{
+    if (duplicateSolids.empty ()) {
+        return shape;
+    }
+
+    // the same parts as the meshes of the output: solids, free shells and free faces
+    BRep_Builder builder;
+    TopoDS_Compound result;
+    builder.MakeCompound (result);
+    for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        if (!IsDuplicate (ex.Current ())) {
+            builder.Add (result, ex.Current ());
+        }
+    }
+    for (TopExp_Explorer ex (shape, TopAbs_SHELL, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        builder.Add (result, ex.Current ());
+    }
+    for (TopExp_Explorer ex (shape, TopAbs_FACE, TopAbs_SHELL); ex.More (); ex.Next ()) {
+        builder.Add (result, ex.Current ());
+    }
+    return result;
+}
+
+void SolidDeduplicator::TransferTriangulations () const
+{
+    for (const DedupInstance& duplicate : duplicates) {
+        const DedupSolid& prototype = prototypes[duplicate.prototype];
+        for (std::size_t faceIndex = 0; faceIndex < duplicate.faces.size (); faceIndex++) {
+            TransferTriangulation (prototype.faces[faceIndex], duplicate.faces[faceIndex], duplicate.transformation);
+        }
+    }
+}
+
+void SolidDeduplicator::AddSolid (const TopoDS_Shape& solid)
+{
+    // instances of the same solid share the triangulation anyway
+    if (!visitedSolids.insert (solid.TShape ().get ()).second) {
+        return;
+    }
+
+    DedupSolid dedupSolid;
+    std::size_t signature = 0;
+    if (!GetDedupSolid (solid, dedupSolid, signature)) {
+        return;
+    }
+
+    std::vector<int>& candidates = prototypesBySignature[signature];
+    for (int candidate : candidates) {
+        gp_Trsf transformation;
+        if (IsSameSolid (prototypes[candidate], dedupSolid, transformation)) {
+            DedupInstance duplicate;
+            duplicate.prototype = candidate;
+            duplicate.faces = std::move (dedupSolid.faces);
+            duplicate.transformation = transformation;
+            duplicates.push_back (std::move (duplicate));
+            duplicateSolids.insert (solid.TShape ().get ());
+            return;
+        }
+    }
+
+    candidates.push_back ((int) prototypes.size ());
+    prototypes.push_back (std::move (dedupSolid));
+}
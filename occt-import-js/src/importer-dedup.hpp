@@ -0,0 +1,57 @@
+#pragma once
+
+#include "importer.hpp"
+
+#include <TopoDS_Shape.hxx>
+#include <TopoDS_Face.hxx>
+#include <TopoDS_Edge.hxx>
+#include <TopoDS_TShape.hxx>
+#include <gp_Pnt.hxx>
+#include <gp_Trsf.hxx>
+
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+class DedupSolid
+{
+public:
+    DedupSolid ();
+
+    std::vector<TopoDS_Face> faces;
+    std::vector<std::size_t> faceSignatures;
+    std::vector<TopoDS_Edge> edges;
+    std::vector<gp_Pnt> points;
+    Standard_Real tolerance;
+};
+
+class DedupInstance
+{
+public:
+    DedupInstance ();
+
+    int prototype;
+    std::vector<TopoDS_Face> faces;
+    gp_Trsf transformation;
+};
+
+class SolidDeduplicator
+{
+public:
+    SolidDeduplicator (const ImportParams& params);
+
+    void AddShape (const TopoDS_Shape& shape);
+    bool IsDuplicate (const TopoDS_Shape& solid) const;
+    TopoDS_Shape RemoveDuplicates (const TopoDS_Shape& shape) const;
+    void TransferTriangulations () const;
+
+private:
+    void AddSolid (const TopoDS_Shape& solid);
+
+    bool enabled;
+    std::vector<DedupSolid> prototypes;
+    std::unordered_map<std::size_t, std::vector<int>> prototypesBySignature;
+    std::vector<DedupInstance> duplicates;
+    std::unordered_set<const TopoDS_TShape*> visitedSolids;
+    std::unordered_set<const TopoDS_TShape*> duplicateSolids;
+};
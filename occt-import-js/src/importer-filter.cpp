@@ -0,0 +1,42 @@
+#include "importer-filter.hpp"
+
+bool MatchPattern (const std::string& pattern, const std::string& value)
+{
+    // greedy matching with backtracking to the last star
+    size_t patternPos = 0;
+    size_t valuePos = 0;
+    size_t starPos = std::string::npos;
+    size_t starValuePos = 0;
+    while (valuePos < value.size ()) {
+        if (patternPos < pattern.size () && (pattern[patternPos] == '?' || pattern[patternPos] == value[valuePos])) {
+            patternPos += 1;
+            valuePos += 1;
+        } else if (patternPos < pattern.size () && pattern[patternPos] == '*') {
+            starPos = patternPos;
+            starValuePos = valuePos;
+            patternPos += 1;
+        } else if (starPos != std::string::npos) {
+            patternPos = starPos + 1;
+            starValuePos += 1;
+            valuePos = starValuePos;
+        } else {
+            return false;
+        }
+    }
+    while (patternPos < pattern.size () && pattern[patternPos] == '*') {
+        patternPos += 1;
+    }
+    return patternPos == pattern.size ();
+}
+
+bool MatchAnyPattern (const std::vector<std::string>& patterns, const std::vector<std::string>& values)
+{
+    for (const std::string& pattern : patterns) {
+        for (const std::string& value : values) {
+            if (!value.empty () && MatchPattern (pattern, value)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// the pattern can contain * for any number of characters and ? for one character
+bool MatchPattern (const std::string& pattern, const std::string& value);
+bool MatchAnyPattern (const std::vector<std::string>& patterns, const std::vector<std::string>& values);
@@ -0,0 +1,56 @@
+#include "importer-hierarchy.hpp"
+
+#include <utility>
+
+ResultFlatHierarchy::ResultFlatHierarchy () :
+    parents (),
+    firstChildren (),
+    nextSiblings (),
+    nameOffsets (),
+    names (),
+    meshOffsets (),
+    meshes ()
+{
+
+}
+
+void FlattenHierarchy (const ResultNode& root, ResultFlatHierarchy& hierarchy)
+{
+    hierarchy = ResultFlatHierarchy ();
+    hierarchy.nameOffsets.push_back (0);
+    hierarchy.meshOffsets.push_back (0);
+
+    // an explicit stack instead of recursion, so deep assemblies can't overflow the call stack,
+    // the children are pushed in reverse order, so they are visited in the original order
+    std::vector<std::pair<const ResultNode*, std::int32_t>> stack;
+    std::vector<std::int32_t> lastChildren;
+    stack.push_back ({ &root, -1 });
+    while (!stack.empty ()) {
+        const ResultNode* node = stack.back ().first;
+        std::int32_t parent = stack.back ().second;
+        stack.pop_back ();
+
+        std::int32_t nodeIndex = (std::int32_t) hierarchy.parents.size ();
+        hierarchy.parents.push_back (parent);
+        hierarchy.firstChildren.push_back (-1);
+        hierarchy.nextSiblings.push_back (-1);
+        lastChildren.push_back (-1);
+        if (parent != -1) {
+            if (lastChildren[parent] == -1) {
+                hierarchy.firstChildren[parent] = nodeIndex;
+            } else {
+                hierarchy.nextSiblings[lastChildren[parent]] = nodeIndex;
+            }
+            lastChildren[parent] = nodeIndex;
+        }
+
+        hierarchy.names.insert (hierarchy.names.end (), node->name.begin (), node->name.end ());
+        hierarchy.nameOffsets.push_back ((std::uint32_t) hierarchy.names.size ());
+        hierarchy.meshes.insert (hierarchy.meshes.end (), node->meshes.begin (), node->meshes.end ());
+        hierarchy.meshOffsets.push_back ((std::uint32_t) hierarchy.meshes.size ());
+
+        for (auto it = node->children.rbegin (); it != node->children.rend (); ++it) {
+            stack.push_back ({ &*it, nodeIndex });
+        }
+    }
+}
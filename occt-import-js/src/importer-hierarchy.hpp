@@ -0,0 +1,25 @@
+#pragma once
+
+#include "importer-result.hpp"
+
+#include <vector>
+#include <cstdint>
+
+class ResultFlatHierarchy
+{
+public:
+    ResultFlatHierarchy ();
+
+    // one value per node in depth-first order, the root is the first node, -1 means no node
+    std::vector<std::int32_t> parents;
+    std::vector<std::int32_t> firstChildren;
+    std::vector<std::int32_t> nextSiblings;
+    // node count + 1 values: the name of node i is between nameOffsets[i] and nameOffsets[i + 1] in names
+    std::vector<std::uint32_t> nameOffsets;
+    std::vector<std::uint8_t> names;
+    // node count + 1 values: the meshes of node i are between meshOffsets[i] and meshOffsets[i + 1] in meshes
+    std::vector<std::uint32_t> meshOffsets;
+    std::vector<std::uint32_t> meshes;
+};
+
+void FlattenHierarchy (const ResultNode& root, ResultFlatHierarchy& hierarchy);
@@ -1,35 +1,67 @@
 #include "importer-iges.hpp"
 #include "importer-utils.hpp"
+#include "importer-trace.hpp"
 
 #include <TDocStd_Document.hxx>
 #include <IGESCAFControl_Reader.hxx>
+#include <IGESControl_Controller.hxx>
+#include <OSD_Process.hxx>
+
+#include <atomic>
+#include <mutex>
+
+static void InitIgesController ()
+{
+    // the controller registers itself in a global table, so it must be initialized only once
+    static std::once_flag initFlag;
+    std::call_once (initFlag, [] () {
+        IGESControl_Controller::Init ();
+    });
+}
+
+static std::string GetTempFileName ()
+{
+    // every import needs its own file, so the name contains the process id and a counter
+    static std::atomic<unsigned int> tempFileCounter (0);
+    OSD_Process process;
+    return "temp_" + std::to_string (process.ProcessId ()) + "_" + std::to_string (tempFileCounter++) + ".igs";
+}
 
 ImporterIges::ImporterIges () :
     ImporterXcaf ()
 {
-
+    InitIgesController ();
 }
 
-bool ImporterIges::TransferToDocument (const std::vector<std::uint8_t>& fileContent)
+bool ImporterIges::TransferToDocument (std::istream& inputStream, const ImportParams& params)
 {
     // IGESCAFControl_Reader::ReadStream is not implemented, so the stream
     // should be written to a temporary file to import the content from
-    std::string dummyFileName = "temp.igs";
-    std::ofstream dummyFile;
-    dummyFile.open (dummyFileName, std::ios::binary);
-    dummyFile.write ((char*) fileContent.data (), fileContent.size ());
-    dummyFile.close ();
+    std::string dummyFileName = GetTempFileName ();
+    {
+        TraceScope writeScope (params.tracer, "WriteTempFile");
+        std::ofstream dummyFile;
+        dummyFile.open (dummyFileName, std::ios::binary);
+        dummyFile << inputStream.rdbuf ();
+        dummyFile.close ();
+    }
 
     IGESCAFControl_Reader igesCafReader;
     igesCafReader.SetColorMode (true);
     igesCafReader.SetNameMode (true);
 
-    IFSelect_ReturnStatus readStatus = igesCafReader.ReadFile (dummyFileName.c_str ());
+    IFSelect_ReturnStatus readStatus = IFSelect_RetVoid;
+    {
+        TraceScope readScope (params.tracer, "ReadFile");
+        readStatus = igesCafReader.ReadFile (dummyFileName.c_str ());
+    }
     if (readStatus != IFSelect_RetDone) {
         std::remove (dummyFileName.c_str ());
         return false;
     }
 
+    TraceScope transferScope (params.tracer, "Transfer");
+    transferScope.AddArg ("roots", igesCafReader.NbRootsForTransfer ());
     if (!igesCafReader.Transfer (document)) {
         std::remove (dummyFileName.c_str ());
         return false;
@@ -8,5 +8,5 @@ public:
     ImporterIges ();
 
 private:
-    virtual bool TransferToDocument (const std::vector<std::uint8_t>& fileContent) override;
+    virtual bool TransferToDocument (std::istream& inputStream, const ImportParams& params) override;
 };
@@ -0,0 +1,544 @@
+#include "importer-result.hpp"
+#include "importer-cache.hpp"
+#include "importer-decimation.hpp"
+#include "importer-reuse.hpp"
+#include "importer-trace.hpp"
+
+#include <OSD_Parallel.hxx>
+
+#include <cstring>
+#include <utility>
+
+static const std::uint32_t SerializedResultMagic = 0x434A494F; // OIJC
+static const std::uint32_t SerializedResultVersion = 3;
+// the data ends with the hex string of the hash of the preceding bytes
+static const size_t SerializedChecksumSize = sizeof (std::uint32_t) + 16;
+// the minimal size of the items in the data, counts are bounded by the remaining bytes
+static const size_t SerializedMinNodeSize = 3 * sizeof (std::uint32_t);
+static const size_t SerializedMinMeshSize = 7 * sizeof (std::uint32_t);
+static const size_t SerializedMinBrepFaceSize = 3 * sizeof (std::uint32_t);
+
+class BinaryWriter
+{
+public:
+    BinaryWriter (std::vector<std::uint8_t>& data) :
+        data (data)
+    {
+
+    }
+
+    void WriteBytes (const void* bytes, size_t size)
+    {
+        const std::uint8_t* begin = (const std::uint8_t*) bytes;
+        data.insert (data.end (), begin, begin + size);
+    }
+
+    void WriteUInt32 (std::uint32_t value)
+    {
+        WriteBytes (&value, sizeof (value));
+    }
+
+    void WriteInt32 (std::int32_t value)
+    {
+        WriteBytes (&value, sizeof (value));
+    }
+
+    void WriteDouble (double value)
+    {
+        WriteBytes (&value, sizeof (value));
+    }
+
+    void WriteString (const std::string& value)
+    {
+        WriteUInt32 ((std::uint32_t) value.size ());
+        WriteBytes (value.data (), value.size ());
+    }
+
+    void WriteColor (bool hasColor, const Color& color)
+    {
+        WriteUInt32 (hasColor ? 1 : 0);
+        if (hasColor) {
+            WriteDouble (color.r);
+            WriteDouble (color.g);
+            WriteDouble (color.b);
+        }
+    }
+
+    template <typename T>
+    void WriteArray (const std::vector<T>& values)
+    {
+        WriteUInt32 ((std::uint32_t) values.size ());
+        WriteBytes (values.data (), values.size () * sizeof (T));
+    }
+
+private:
+    std::vector<std::uint8_t>& data;
+};
+
+class BinaryReader
+{
+public:
+    BinaryReader (const std::vector<std::uint8_t>& data, size_t size) :
+        data (data),
+        size (size),
+        position (0)
+    {
+
+    }
+
+    bool IsEnd () const
+    {
+        return position == size;
+    }
+
+    size_t GetRemainingSize () const
+    {
+        return size - position;
+    }
+
+    bool ReadBytes (void* bytes, size_t byteCount)
+    {
+        if (byteCount > size - position) {
+            return false;
+        }
+        if (byteCount > 0) {
+            std::memcpy (bytes, data.data () + position, byteCount);
+        }
+        position += byteCount;
+        return true;
+    }
+
+    bool Skip (size_t byteCount)
+    {
+        if (byteCount > size - position) {
+            return false;
+        }
+        position += byteCount;
+        return true;
+    }
+
+    bool ReadUInt32 (std::uint32_t& value)
+    {
+        return ReadBytes (&value, sizeof (value));
+    }
+
+    bool ReadInt32 (std::int32_t& value)
+    {
+        return ReadBytes (&value, sizeof (value));
+    }
+
+    bool ReadDouble (double& value)
+    {
+        return ReadBytes (&value, sizeof (value));
+    }
+
+    bool ReadString (std::string& value)
+    {
+        std::uint32_t length = 0;
+        if (!ReadUInt32 (length) || length > size - position) {
+            return false;
+        }
+        value.assign ((const char*) data.data () + position, length);
+        position += length;
+        return true;
+    }
+
+    bool ReadColor (bool& hasColor, Color& color)
+    {
+        std::uint32_t hasColorValue = 0;
+        if (!ReadUInt32 (hasColorValue)) {
+            return false;
+        }
+        hasColor = (hasColorValue != 0);
+        if (hasColor) {
+            return ReadDouble (color.r) && ReadDouble (color.g) && ReadDouble (color.b);
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool ReadArray (std::vector<T>& values)
+    {
+        std::uint32_t count = 0;
+        if (!ReadCount (count, sizeof (T))) {
+            return false;
+        }
+        values.resize (count);
+        return ReadBytes (values.data (), count * sizeof (T));
+    }
+
+    bool ReadCount (std::uint32_t& count, size_t minItemSize)
+    {
+        // every item takes at least this many bytes, so a corrupt count can't cause a huge allocation
+        return ReadUInt32 (count) && count <= (size - position) / minItemSize;
+    }
+
+private:
+    const std::vector<std::uint8_t>& data;
+    size_t size;
+    size_t position;
+};
+
+class FaceTask
+{
+public:
+    FaceTask () :
+        mesh (0),
+        firstVertex (0),
+        firstTriangle (0),
+        hasNormals (false),
+        writer ()
+    {
+
+    }
+
+    size_t mesh;
+    size_t firstVertex;
+    size_t firstTriangle;
+    bool hasNormals;
+    FaceWriter writer;
+};
+
+class ExtractionState
+{
+public:
+    ExtractionState () :
+        faceTasks (),
+        decimatedMeshes ()
+    {
+
+    }
+
+    std::vector<FaceTask> faceTasks;
+    std::vector<size_t> decimatedMeshes;
+};
+
+static void ExtractMesh (const Mesh& mesh, bool extractNormals, size_t meshIndex, ResultMesh& resultMesh, ExtractionState& state, Tracer* tracer)
+{
+    TraceScope meshScope (tracer, "ExtractMesh");
+    resultMesh.name = mesh.GetName ();
+    resultMesh.hasColor = mesh.GetColor (resultMesh.color);
+    meshScope.AddArg ("name", resultMesh.name);
+
+    // the first pass only calculates the size of the buffers and the offset of every face,
+    // the geometry is written later when all of the buffers are allocated, normals are written
+    // for every face or for none of them, the writer computes them if the triangulation has none
+    size_t vertexCount = 0;
+    size_t triangleCount = 0;
+    mesh.EnumerateFaces ([&](const Face& face) {
+        int faceVertexCount = face.GetVertexCount ();
+        int faceTriangleCount = face.GetTriangleCount ();
+        if (faceVertexCount > 0) {
+            FaceTask faceTask;
+            faceTask.mesh = meshIndex;
+            faceTask.firstVertex = vertexCount;
+            faceTask.firstTriangle = triangleCount;
+            faceTask.hasNormals = extractNormals;
+            faceTask.writer = face.GetWriter ();
+            state.faceTasks.push_back (std::move (faceTask));
+        }
+
+        ResultBrepFace brepFace;
+        brepFace.first = (int) triangleCount;
+        brepFace.last = (int) (triangleCount + faceTriangleCount) - 1;
+        brepFace.hasColor = face.GetColor (brepFace.color);
+        resultMesh.brepFaces.push_back (brepFace);
+
+        vertexCount += faceVertexCount;
+        triangleCount += faceTriangleCount;
+    });
+
+    resultMesh.positions.resize (vertexCount * 3);
+    resultMesh.normals.resize (extractNormals ? vertexCount * 3 : 0);
+    resultMesh.indices.resize (triangleCount * 3);
+    meshScope.AddArg ("faces", (int) resultMesh.brepFaces.size ());
+}
+
+static void ExtractNode (const NodePtr& rootNode, const ImportParams& params, ResultNode& rootResultNode, std::vector<ResultMesh>& resultMeshes, ExtractionState& state)
+{
+    // an explicit stack instead of recursion, so deep assemblies can't overflow the call stack,
+    // the children are pushed in reverse order, so the meshes are extracted in depth-first order
+    bool decimate = (params.decimationRatio < 1.0 || params.decimationMaxError > 0.0);
+    std::vector<std::pair<NodePtr, ResultNode*>> stack;
+    stack.push_back ({ rootNode, &rootResultNode });
+    while (!stack.empty ()) {
+        NodePtr node = stack.back ().first;
+        ResultNode& resultNode = *stack.back ().second;
+        stack.pop_back ();
+
+        resultNode.name = node->GetName ();
+        if (node->IsMeshNode ()) {
+            node->EnumerateMeshes ([&](const Mesh& mesh) {
+                size_t meshIndex = resultMeshes.size ();
+                resultMeshes.push_back (ResultMesh ());
+                ResultMesh& resultMesh = resultMeshes.back ();
+                resultMesh.shapeKey = mesh.GetShapeKey ();
+                resultNode.meshes.push_back ((int) meshIndex);
+                if (params.meshReuse != nullptr && params.meshReuse->ReuseMesh (mesh, resultMesh)) {
+                    return;
+                }
+                ExtractMesh (mesh, params.computeNormals, meshIndex, resultMesh, state, params.tracer);
+                if (decimate) {
+                    state.decimatedMeshes.push_back (meshIndex);
+                }
+            });
+        }
+
+        // the children are not resized later, so the pointers to them remain valid
+        std::vector<NodePtr> children = node->GetChildren ();
+        resultNode.children.resize (children.size ());
+        for (size_t childIndex = children.size (); childIndex > 0; childIndex--) {
+            stack.push_back ({ children[childIndex - 1], &resultNode.children[childIndex - 1] });
+        }
+    }
+}
+
+static void WriteMeshes (const ImportParams& params, const ExtractionState& state, std::vector<ResultMesh>& resultMeshes)
+{
+    // every face has its own range in the buffers, so the faces of all meshes can be written in parallel
+    TraceScope writeScope (params.tracer, "WriteFaces");
+    writeScope.AddArg ("faces", (int) state.faceTasks.size ());
+    OSD_Parallel::For (0, (int) state.faceTasks.size (), [&](int index) {
+        const FaceTask& faceTask = state.faceTasks[index];
+        ResultMesh& resultMesh = resultMeshes[faceTask.mesh];
+        double* positions = resultMesh.positions.data () + faceTask.firstVertex * 3;
+        double* normals = faceTask.hasNormals ? resultMesh.normals.data () + faceTask.firstVertex * 3 : nullptr;
+        std::uint32_t* indices = resultMesh.indices.data () + faceTask.firstTriangle * 3;
+        faceTask.writer (positions, normals, indices, (std::uint32_t) faceTask.firstVertex);
+    });
+
+    OSD_Parallel::For (0, (int) state.decimatedMeshes.size (), [&](int index) {
+        TraceScope decimateScope (params.tracer, "DecimateMesh");
+        DecimateMesh (resultMeshes[state.decimatedMeshes[index]], params.decimationRatio, params.decimationMaxError);
+    });
+}
+
+static void SerializeNode (const ResultNode& rootNode, BinaryWriter& writer)
+{
+    // the nodes are written in depth-first order with an explicit stack, like they are read
+    std::vector<const ResultNode*> stack;
+    stack.push_back (&rootNode);
+    while (!stack.empty ()) {
+        const ResultNode* node = stack.back ();
+        stack.pop_back ();
+        writer.WriteString (node->name);
+        writer.WriteArray (node->meshes);
+        writer.WriteUInt32 ((std::uint32_t) node->children.size ());
+        for (auto it = node->children.rbegin (); it != node->children.rend (); ++it) {
+            stack.push_back (&*it);
+        }
+    }
+}
+
+static bool DeserializeNode (BinaryReader& reader, ResultNode& rootNode)
+{
+    // the depth of the hierarchy is not limited, the nodes on the stack are allocated but not read yet,
+    // so they must fit in the remaining data together with the new children
+    std::vector<ResultNode*> stack;
+    stack.push_back (&rootNode);
+    while (!stack.empty ()) {
+        ResultNode* node = stack.back ();
+        stack.pop_back ();
+        std::uint32_t childCount = 0;
+        if (!reader.ReadString (node->name) || !reader.ReadArray (node->meshes) || !reader.ReadCount (childCount, SerializedMinNodeSize)) {
+            return false;
+        }
+        if (stack.size () + childCount > reader.GetRemainingSize () / SerializedMinNodeSize) {
+            return false;
+        }
+        node->children.resize (childCount);
+        for (auto it = node->children.rbegin (); it != node->children.rend (); ++it) {
+            stack.push_back (&*it);
+        }
+    }
+    return true;
+}
+
+static bool IsValidNode (const ResultNode& rootNode, size_t meshCount)
+{
+    std::vector<const ResultNode*> stack;
+    stack.push_back (&rootNode);
+    while (!stack.empty ()) {
+        const ResultNode* node = stack.back ();
+        stack.pop_back ();
+        for (std::uint32_t meshIndex : node->meshes) {
+            if (meshIndex >= meshCount) {
+                return false;
+            }
+        }
+        for (const ResultNode& child : node->children) {
+            stack.push_back (&child);
+        }
+    }
+    return true;
+}
+
+static void SerializeMesh (const ResultMesh& mesh, BinaryWriter& writer)
+{
+    writer.WriteString (mesh.name);
+    writer.WriteString (mesh.shapeKey);
+    writer.WriteColor (mesh.hasColor, mesh.color);
+    writer.WriteArray (mesh.positions);
+    writer.WriteArray (mesh.normals);
+    writer.WriteArray (mesh.indices);
+    writer.WriteUInt32 ((std::uint32_t) mesh.brepFaces.size ());
+    for (const ResultBrepFace& brepFace : mesh.brepFaces) {
+        writer.WriteInt32 (brepFace.first);
+        writer.WriteInt32 (brepFace.last);
+        writer.WriteColor (brepFace.hasColor, brepFace.color);
+    }
+}
+
+static bool DeserializeMesh (BinaryReader& reader, ResultMesh& mesh)
+{
+    if (!reader.ReadString (mesh.name) || !reader.ReadString (mesh.shapeKey) || !reader.ReadColor (mesh.hasColor, mesh.color)) {
+        return false;
+    }
+    if (!reader.ReadArray (mesh.positions) || !reader.ReadArray (mesh.normals) || !reader.ReadArray (mesh.indices)) {
+        return false;
+    }
+    std::uint32_t brepFaceCount = 0;
+    if (!reader.ReadCount (brepFaceCount, SerializedMinBrepFaceSize)) {
+        return false;
+    }
+    mesh.brepFaces.resize (brepFaceCount);
+    for (ResultBrepFace& brepFace : mesh.brepFaces) {
+        if (!reader.ReadInt32 (brepFace.first) || !reader.ReadInt32 (brepFace.last) || !reader.ReadColor (brepFace.hasColor, brepFace.color)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool IsValidMesh (const ResultMesh& mesh)
+{
+    if (mesh.positions.size () % 3 != 0 || mesh.indices.size () % 3 != 0) {
+        return false;
+    }
+    if (!mesh.normals.empty () && mesh.normals.size () != mesh.positions.size ()) {
+        return false;
+    }
+    size_t vertexCount = mesh.positions.size () / 3;
+    for (std::uint32_t index : mesh.indices) {
+        if (index >= vertexCount) {
+            return false;
+        }
+    }
+    std::int64_t triangleCount = (std::int64_t) mesh.indices.size () / 3;
+    for (const ResultBrepFace& brepFace : mesh.brepFaces) {
+        if (brepFace.first < 0 || brepFace.last < brepFace.first - 1 || brepFace.last >= triangleCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+ResultBrepFace::ResultBrepFace () :
+    first (0),
+    last (-1),
+    hasColor (false),
+    color ()
+{
+
+}
+
+ResultMesh::ResultMesh () :
+    name (),
+    shapeKey (),
+    hasColor (false),
+    color (),
+    positions (),
+    normals (),
+    indices (),
+    brepFaces ()
+{
+
+}
+
+ResultNode::ResultNode () :
+    name (),
+    meshes (),
+    children ()
+{
+
+}
+
+ImportResult::ImportResult () :
+    root (),
+    meshes ()
+{
+
+}
+
+void ExtractResult (const NodePtr& rootNode, const ImportParams& params, ImportResult& result)
+{
+    TraceScope extractScope (params.tracer, "ExtractResult");
+    result = ImportResult ();
+    ExtractionState state;
+    ExtractNode (rootNode, params, result.root, result.meshes, state);
+    WriteMeshes (params, state, result.meshes);
+}
+
+void SerializeResult (const ImportResult& result, const std::string& key, std::vector<std::uint8_t>& data)
+{
+    data.clear ();
+    BinaryWriter writer (data);
+    writer.WriteUInt32 (SerializedResultMagic);
+    writer.WriteUInt32 (SerializedResultVersion);
+    writer.WriteString (key);
+    SerializeNode (result.root, writer);
+    writer.WriteUInt32 ((std::uint32_t) result.meshes.size ());
+    for (const ResultMesh& mesh : result.meshes) {
+        SerializeMesh (mesh, writer);
+    }
+
+    Hasher hasher;
+    hasher.AddBytes (data.data (), data.size ());
+    writer.WriteString (hasher.GetHexString ());
+}
+
+bool DeserializeResult (const std::vector<std::uint8_t>& data, std::string& key, ImportResult& result)
+{
+    // the data comes from the caller, so it is checked before anything is allocated based on it
+    if (data.size () < SerializedChecksumSize) {
+        return false;
+    }
+    size_t contentSize = data.size () - SerializedChecksumSize;
+    Hasher hasher;
+    hasher.AddBytes (data.data (), contentSize);
+    BinaryReader checksumReader (data, data.size ());
+    std::string checksum;
+    if (!checksumReader.Skip (contentSize) || !checksumReader.ReadString (checksum) || checksum != hasher.GetHexString ()) {
+        return false;
+    }
+
+    BinaryReader reader (data, contentSize);
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    if (!reader.ReadUInt32 (magic) || magic != SerializedResultMagic) {
+        return false;
+    }
+    if (!reader.ReadUInt32 (version) || version != SerializedResultVersion) {
+        return false;
+    }
+    if (!reader.ReadString (key)) {
+        return false;
+    }
+
+    result = ImportResult ();
+    if (!DeserializeNode (reader, result.root)) {
+        return false;
+    }
+
+    std::uint32_t meshCount = 0;
+    if (!reader.ReadCount (meshCount, SerializedMinMeshSize)) {
+        return false;
+    }
+    result.meshes.resize (meshCount);
+    for (ResultMesh& mesh : result.meshes) {
+        if (!DeserializeMesh (reader, mesh) || !IsValidMesh (mesh)) {
+            return false;
+        }
+    }
+    return reader.IsEnd () && IsValidNode (result.root, result.meshes.size ());
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "importer.hpp"
+
+#include <cstdint>
+
+class ResultBrepFace
+{
+public:
+    ResultBrepFace ();
+
+    int first;
+    int last;
+    bool hasColor;
+    Color color;
+};
+
+class ResultMesh
+{
+public:
+    ResultMesh ();
+
+    std::string name;
+    std::string shapeKey;
+    bool hasColor;
+    Color color;
+
+    std::vector<double> positions;
+    std::vector<double> normals;
+    std::vector<std::uint32_t> indices;
+    std::vector<ResultBrepFace> brepFaces;
+};
+
+class ResultNode
+{
+public:
+    ResultNode ();
+
+    std::string name;
+    std::vector<int> meshes;
+    std::vector<ResultNode> children;
+};
+
+class ImportResult
+{
+public:
+    ImportResult ();
+
+    ResultNode root;
+    std::vector<ResultMesh> meshes;
+};
+
+void ExtractResult (const NodePtr& rootNode, const ImportParams& params, ImportResult& result);
+
+void SerializeResult (const ImportResult& result, const std::string& key, std::vector<std::uint8_t>& data);
+bool DeserializeResult (const std::vector<std::uint8_t>& data, std::string& key, ImportResult& result);
@@ -0,0 +1,149 @@
+#include "importer-reuse.hpp"
+#include "importer-cache.hpp"
+
+#include <TopExp_Explorer.hxx>
+#include <TopoDS_Compound.hxx>
+#include <BRep_Builder.hxx>
+#include <BRepTools.hxx>
+
+#include <sstream>
+
+// the keys are built from two hashes with different seeds, a collision would reuse the mesh of another shape
+static const std::uint64_t ShapeKeySeeds[2] = { 0x0ULL, 0x9E3779B97F4A7C15ULL };
+
+static size_t GetFaceCount (const TopoDS_Shape& shape)
+{
+    size_t faceCount = 0;
+    for (TopExp_Explorer ex (shape, TopAbs_FACE); ex.More (); ex.Next ()) {
+        faceCount += 1;
+    }
+    return faceCount;
+}
+
+MeshReuse::MeshReuse () :
+    previousMeshes (),
+    previousMeshIndices (),
+    shapeKeys (),
+    reusedMeshCount (0)
+{
+
+}
+
+void MeshReuse::AddPreviousResult (ImportResult& result)
+{
+    // the meshes are moved out from the result, so they are not stored twice
+    for (ResultMesh& mesh : result.meshes) {
+        if (mesh.shapeKey.empty () || previousMeshIndices.find (mesh.shapeKey) != previousMeshIndices.end ()) {
+            continue;
+        }
+        previousMeshIndices.insert ({ mesh.shapeKey, previousMeshes.size () });
+        previousMeshes.push_back (std::move (mesh));
+    }
+}
+
+bool MeshReuse::HasPreviousMeshes () const
+{
+    return !previousMeshes.empty ();
+}
+
+TopoDS_Shape MeshReuse::RemoveReusableParts (const TopoDS_Shape& shape, const ImportParams& params, Standard_Real linDeflection)
+{
+    // the keys are calculated for every solid and free shell, so the next import can use them,
+    // free faces are not reused, they are always triangulated again
+    BRep_Builder builder;
+    TopoDS_Compound result;
+    builder.MakeCompound (result);
+    for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        if (!AddShapeKey (ex.Current (), params, linDeflection)) {
+            builder.Add (result, ex.Current ());
+        }
+    }
+    for (TopExp_Explorer ex (shape, TopAbs_SHELL, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        if (!AddShapeKey (ex.Current (), params, linDeflection)) {
+            builder.Add (result, ex.Current ());
+        }
+    }
+    for (TopExp_Explorer ex (shape, TopAbs_FACE, TopAbs_SHELL); ex.More (); ex.Next ()) {
+        builder.Add (result, ex.Current ());
+    }
+    return result;
+}
+
+std::string MeshReuse::GetShapeKey (const TopoDS_Shape& shape) const
+{
+    const std::string* shapeKey = shapeKeys.Seek (shape);
+    if (shapeKey == nullptr) {
+        return std::string ();
+    }
+    return *shapeKey;
+}
+
+bool MeshReuse::ReuseMesh (const Mesh& mesh, ResultMesh& resultMesh)
+{
+    auto found = previousMeshIndices.find (resultMesh.shapeKey);
+    if (resultMesh.shapeKey.empty () || found == previousMeshIndices.end ()) {
+        return false;
+    }
+
+    // only the geometry is reused, names and colors are read from the new file
+    const ResultMesh& previousMesh = previousMeshes[found->second];
+    std::vector<ResultBrepFace> brepFaces = previousMesh.brepFaces;
+    size_t faceCount = 0;
+    mesh.EnumerateFaces ([&](const Face& face) {
+        if (faceCount < brepFaces.size ()) {
+            brepFaces[faceCount].hasColor = face.GetColor (brepFaces[faceCount].color);
+        }
+        faceCount += 1;
+    });
+    if (faceCount != brepFaces.size ()) {
+        return false;
+    }
+
+    resultMesh.name = mesh.GetName ();
+    resultMesh.hasColor = mesh.GetColor (resultMesh.color);
+    resultMesh.positions = previousMesh.positions;
+    resultMesh.normals = previousMesh.normals;
+    resultMesh.indices = previousMesh.indices;
+    resultMesh.brepFaces = std::move (brepFaces);
+    reusedMeshCount += 1;
+    return true;
+}
+
+int MeshReuse::GetReusedMeshCount () const
+{
+    return reusedMeshCount;
+}
+
+void MeshReuse::ReleaseShapes ()
+{
+    // the shapes keep the imported document alive, so they are released together with the importer
+    shapeKeys.Clear ();
+    std::vector<ResultMesh> ().swap (previousMeshes);
+    previousMeshIndices.clear ();
+}
+
+bool MeshReuse::AddShapeKey (const TopoDS_Shape& shape, const ImportParams& params, Standard_Real linDeflection)
+{
+    // the key contains the geometry with the placement, and everything that affects the triangulation
+    std::ostringstream shapeStream;
+    BRepTools::Write (shape, shapeStream, Standard_False, Standard_False, TopTools_FormatVersion_CURRENT);
+
+    std::string shapeText = shapeStream.str ();
+    std::string shapeKey;
+    for (std::uint64_t seed : ShapeKeySeeds) {
+        Hasher hasher (seed);
+        AddImportParams (hasher, params);
+        hasher.AddDouble (linDeflection);
+        hasher.AddString (shapeText);
+        shapeKey += hasher.GetHexString ();
+    }
+    shapeKeys.Bind (shape, shapeKey);
+
+    // the shape is not triangulated if it's excluded here, so the previous mesh must have
+    // a range for every face, otherwise the extraction would find faces without triangulation
+    auto found = previousMeshIndices.find (shapeKey);
+    if (found == previousMeshIndices.end ()) {
+        return false;
+    }
+    return previousMeshes[found->second].brepFaces.size () == GetFaceCount (shape);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "importer.hpp"
+#include "importer-result.hpp"
+
+#include <TopoDS_Shape.hxx>
+#include <TopTools_ShapeMapHasher.hxx>
+#include <NCollection_DataMap.hxx>
+
+#include <unordered_map>
+
+class MeshReuse
+{
+public:
+    MeshReuse ();
+
+    void AddPreviousResult (ImportResult& result);
+    bool HasPreviousMeshes () const;
+
+    TopoDS_Shape RemoveReusableParts (const TopoDS_Shape& shape, const ImportParams& params, Standard_Real linDeflection);
+    std::string GetShapeKey (const TopoDS_Shape& shape) const;
+
+    bool ReuseMesh (const Mesh& mesh, ResultMesh& resultMesh);
+    int GetReusedMeshCount () const;
+    void ReleaseShapes ();
+
+private:
+    bool AddShapeKey (const TopoDS_Shape& shape, const ImportParams& params, Standard_Real linDeflection);
+
+    std::vector<ResultMesh> previousMeshes;
+    std::unordered_map<std::string, size_t> previousMeshIndices;
+    NCollection_DataMap<TopoDS_Shape, std::string, TopTools_ShapeMapHasher> shapeKeys;
+    int reusedMeshCount;
+};
@@ -1,16 +1,56 @@
 #include "importer-step.hpp"
 #include "importer-utils.hpp"
+#include "importer-filter.hpp"
+#include "importer-trace.hpp"
 
 #include <TDocStd_Document.hxx>
 #include <STEPCAFControl_Reader.hxx>
+#include <STEPCAFControl_Controller.hxx>
+#include <StepBasic_ProductDefinition.hxx>
+#include <StepBasic_ProductDefinitionFormation.hxx>
+#include <StepBasic_Product.hxx>
+#include <TCollection_HAsciiString.hxx>
+
+#include <mutex>
+
+static void InitStepController ()
+{
+    // the controller registers itself in a global table, so it must be initialized only once
+    static std::once_flag initFlag;
+    std::call_once (initFlag, [] () {
+        STEPCAFControl_Controller::Init ();
+    });
+}
+
+static bool IsExcludedRoot (const Handle (Standard_Transient)& root, const ImportParams& params)
+{
+    // only the product of the root is known before the transfer, so it can be matched by name or id
+    Handle (StepBasic_ProductDefinition) productDefinition = Handle (StepBasic_ProductDefinition)::DownCast (root);
+    if (productDefinition.IsNull () || productDefinition->Formation ().IsNull ()) {
+        return false;
+    }
+    Handle (StepBasic_Product) product = productDefinition->Formation ()->OfProduct ();
+    if (product.IsNull ()) {
+        return false;
+    }
+
+    std::vector<std::string> values;
+    if (!product->Name ().IsNull ()) {
+        values.push_back (product->Name ()->ToCString ());
+    }
+    if (!product->Id ().IsNull ()) {
+        values.push_back (product->Id ()->ToCString ());
+    }
+    return MatchAnyPattern (params.excludeNodes, values);
+}
 
 ImporterStep::ImporterStep () :
     ImporterXcaf ()
 {
-
+    InitStepController ();
 }
 
-bool ImporterStep::TransferToDocument (const std::vector<std::uint8_t>& fileContent)
+bool ImporterStep::TransferToDocument (std::istream& inputStream, const ImportParams& params)
 {
     STEPCAFControl_Reader stepCafReader;
     stepCafReader.SetColorMode (true);
@@ -18,16 +58,31 @@ bool ImporterStep::TransferToDocument (const std::vector<std::uint8_t>& fileCont
 
     STEPControl_Reader& stepReader = stepCafReader.ChangeReader ();
     std::string dummyFileName = "stp";
-    VectorBuffer inputBuffer (fileContent);
-    std::istream inputStream (&inputBuffer);
-    IFSelect_ReturnStatus readStatus = stepReader.ReadStream (dummyFileName.c_str (), inputStream);
+    IFSelect_ReturnStatus readStatus = IFSelect_RetVoid;
+    {
+        TraceScope readScope (params.tracer, "ReadStream");
+        readStatus = stepReader.ReadStream (dummyFileName.c_str (), inputStream);
+    }
     if (readStatus != IFSelect_RetDone) {
         return false;
     }
 
-    if (!stepCafReader.Transfer (document)) {
-        return false;
+    TraceScope transferScope (params.tracer, "Transfer");
+    Standard_Integer rootCount = stepReader.NbRootsForTransfer ();
+    transferScope.AddArg ("roots", rootCount);
+    if (params.excludeNodes.empty ()) {
+        return stepCafReader.Transfer (document);
     }
 
-    return true;
+    // excluded roots are not transferred at all, the other nodes are filtered after the transfer
+    bool transferred = false;
+    for (Standard_Integer rootIndex = 1; rootIndex <= rootCount; rootIndex++) {
+        if (IsExcludedRoot (stepReader.RootForTransfer (rootIndex), params)) {
+            continue;
+        }
+        if (stepCafReader.TransferOneRoot (rootIndex, document)) {
+            transferred = true;
+        }
+    }
+    return transferred;
 }
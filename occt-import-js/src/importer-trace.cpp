@@ -0,0 +1,150 @@
+#include "importer-trace.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <unordered_map>
+
+static std::string EncodeJsonString (const std::string& value)
+{
+    std::ostringstream stream;
+    stream << '"';
+    for (char character : value) {
+        switch (character) {
+            case '"':
+                stream << "\\\"";
+                break;
+            case '\\':
+                stream << "\\\\";
+                break;
+            case '\n':
+                stream << "\\n";
+                break;
+            case '\r':
+                stream << "\\r";
+                break;
+            case '\t':
+                stream << "\\t";
+                break;
+            default:
+                if ((unsigned char) character < 0x20) {
+                    stream << "\\u" << std::hex << std::setw (4) << std::setfill ('0') << (int) character << std::dec;
+                } else {
+                    stream << character;
+                }
+                break;
+        }
+    }
+    stream << '"';
+    return stream.str ();
+}
+
+TraceEvent::TraceEvent () :
+    name (),
+    start (0.0),
+    duration (0.0),
+    threadId (),
+    args ()
+{
+
+}
+
+Tracer::Tracer () :
+    startTime (std::chrono::steady_clock::now ()),
+    mainThreadId (std::this_thread::get_id ()),
+    eventsMutex (),
+    events ()
+{
+
+}
+
+double Tracer::GetTime () const
+{
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now () - startTime;
+    return elapsed.count ();
+}
+
+void Tracer::AddEvent (TraceEvent& event)
+{
+    std::lock_guard<std::mutex> lock (eventsMutex);
+    events.push_back (std::move (event));
+}
+
+std::string Tracer::GetJson () const
+{
+    std::lock_guard<std::mutex> lock (eventsMutex);
+
+    // the thread ids are replaced with small numbers, the thread that created the tracer is the first
+    std::unordered_map<std::thread::id, int> threadIndices;
+    threadIndices.insert ({ mainThreadId, 1 });
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision (3);
+    stream << "{\"traceEvents\":[";
+    for (size_t eventIndex = 0; eventIndex < events.size (); eventIndex++) {
+        const TraceEvent& event = events[eventIndex];
+        int threadIndex = threadIndices.insert ({ event.threadId, (int) threadIndices.size () + 1 }).first->second;
+        if (eventIndex > 0) {
+            stream << ",";
+        }
+        stream << "{\"name\":" << EncodeJsonString (event.name) << ",\"cat\":\"import\",\"ph\":\"X\"";
+        stream << ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+        stream << ",\"pid\":1,\"tid\":" << threadIndex << ",\"args\":{";
+        for (size_t argIndex = 0; argIndex < event.args.size (); argIndex++) {
+            if (argIndex > 0) {
+                stream << ",";
+            }
+            stream << EncodeJsonString (event.args[argIndex].first) << ":" << event.args[argIndex].second;
+        }
+        stream << "}}";
+    }
+    stream << "],\"displayTimeUnit\":\"ms\"}";
+    return stream.str ();
+}
+
+bool Tracer::WriteFile (const std::string& filePath) const
+{
+    std::ofstream outputStream (filePath, std::ios::binary);
+    if (!outputStream.is_open ()) {
+        return false;
+    }
+    outputStream << GetJson ();
+    outputStream.close ();
+    return (bool) outputStream;
+}
+
+TraceScope::TraceScope (Tracer* tracer, const char* name) :
+    tracer (tracer),
+    event ()
+{
+    if (tracer == nullptr) {
+        return;
+    }
+    event.name = name;
+    event.threadId = std::this_thread::get_id ();
+    event.start = tracer->GetTime ();
+}
+
+TraceScope::~TraceScope ()
+{
+    if (tracer == nullptr) {
+        return;
+    }
+    event.duration = tracer->GetTime () - event.start;
+    tracer->AddEvent (event);
+}
+
+void TraceScope::AddArg (const char* name, const std::string& value)
+{
+    if (tracer == nullptr) {
+        return;
+    }
+    event.args.push_back ({ name, EncodeJsonString (value) });
+}
+
+void TraceScope::AddArg (const char* name, int value)
+{
+    if (tracer == nullptr) {
+        return;
+    }
+    event.args.push_back ({ name, std::to_string (value) });
+}
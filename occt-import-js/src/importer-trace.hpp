@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+
+class TraceEvent
+{
+public:
+    TraceEvent ();
+
+    std::string name;
+    double start;
+    double duration;
+    std::thread::id threadId;
+    // the values are already json encoded
+    std::vector<std::pair<std::string, std::string>> args;
+};
+
+// collects the spans of one import, events can be added from any thread
+class Tracer
+{
+public:
+    Tracer ();
+
+    double GetTime () const;
+    void AddEvent (TraceEvent& event);
+
+    std::string GetJson () const;
+    bool WriteFile (const std::string& filePath) const;
+
+private:
+    std::chrono::steady_clock::time_point startTime;
+    std::thread::id mainThreadId;
+    mutable std::mutex eventsMutex;
+    std::vector<TraceEvent> events;
+};
+
+// records the time between its construction and destruction, it does nothing if the tracer is null
+class TraceScope
+{
+public:
+    TraceScope (Tracer* tracer, const char* name);
+    ~TraceScope ();
+
+    void AddArg (const char* name, const std::string& value);
+    void AddArg (const char* name, int value);
+
+private:
+    Tracer* tracer;
+    TraceEvent event;
+};
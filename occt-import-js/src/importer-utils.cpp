@@ -1,20 +1,28 @@
 #include "importer-utils.hpp"
+#include "importer-dedup.hpp"
+#include "importer-reuse.hpp"
+#include "importer-trace.hpp"
 
 #include <TopExp_Explorer.hxx>
 #include <TopoDS.hxx>
 #include <TopoDS_Face.hxx>
+#include <TopoDS_Compound.hxx>
 #include <BRepTools.hxx>
 #include <BRep_Tool.hxx>
+#include <BRep_Builder.hxx>
 
 #include <Bnd_Box.hxx>
 #include <BRepBndLib.hxx>
 #include <BRepMesh_IncrementalMesh.hxx>
 #include <UnitsMethods.hxx>
+#include <OSD_Parallel.hxx>
+#include <Standard.hxx>
+#include <gp.hxx>
+#include <gp_Vec.hxx>
 
-VectorBuffer::VectorBuffer (const std::vector<uint8_t>& v)
-{
-    setg ((char*) v.data (), (char*) v.data (), (char*) (v.data () + v.size ()));
-}
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
 
 OcctFace::OcctFace (const TopoDS_Face& face) :
     Face (),
@@ -23,8 +31,39 @@ OcctFace::OcctFace (const TopoDS_Face& face) :
     location ()
 {
     triangulation = BRep_Tool::Triangulation (face, location);
-    if (HasTriangulation ()) {
-        triangulation->ComputeNormals ();
+}
+
+static void WriteTriangleNormals (const Handle (Poly_Triangulation)& triangulation, const gp_Trsf& transformation, double sign, double* normals)
+{
+    // the triangulation has no normals, so every vertex gets the area weighted sum of its triangle normals
+    std::vector<gp_XYZ> vertexNormals (triangulation->NbNodes (), gp_XYZ (0.0, 0.0, 0.0));
+    for (Standard_Integer triangleIndex = 1; triangleIndex <= triangulation->NbTriangles (); triangleIndex++) {
+        Standard_Integer nodeIndex1 = 0;
+        Standard_Integer nodeIndex2 = 0;
+        Standard_Integer nodeIndex3 = 0;
+        triangulation->Triangle (triangleIndex).Get (nodeIndex1, nodeIndex2, nodeIndex3);
+        gp_XYZ point1 = triangulation->Node (nodeIndex1).XYZ ();
+        gp_XYZ point2 = triangulation->Node (nodeIndex2).XYZ ();
+        gp_XYZ point3 = triangulation->Node (nodeIndex3).XYZ ();
+        gp_XYZ triangleNormal = (point2 - point1).Crossed (point3 - point1);
+        vertexNormals[nodeIndex1 - 1] += triangleNormal;
+        vertexNormals[nodeIndex2 - 1] += triangleNormal;
+        vertexNormals[nodeIndex3 - 1] += triangleNormal;
+    }
+
+    for (size_t vertexIndex = 0; vertexIndex < vertexNormals.size (); vertexIndex++) {
+        gp_Vec direction (vertexNormals[vertexIndex]);
+        direction.Transform (transformation);
+        double magnitude = direction.Magnitude ();
+        if (magnitude > gp::Resolution ()) {
+            direction.Divide (magnitude);
+        } else {
+            direction = gp_Vec (0.0, 0.0, 1.0);
+        }
+        double* normal = normals + vertexIndex * 3;
+        normal[0] = sign * direction.X ();
+        normal[1] = sign * direction.Y ();
+        normal[2] = sign * direction.Z ();
     }
 }
 
@@ -88,6 +127,58 @@ void OcctFace::EnumerateTriangles (const std::function<void (int, int, int)>& on
     }
 }
 
+int OcctFace::GetVertexCount () const
+{
+    return HasTriangulation () ? triangulation->NbNodes () : 0;
+}
+
+int OcctFace::GetTriangleCount () const
+{
+    return HasTriangulation () ? triangulation->NbTriangles () : 0;
+}
+
+FaceWriter OcctFace::GetWriter () const
+{
+    if (!HasTriangulation ()) {
+        return [](double*, double*, std::uint32_t*, std::uint32_t) {};
+    }
+
+    // the face is a temporary object, so the writer keeps its own reference to the triangulation
+    Handle (Poly_Triangulation) faceTriangulation = triangulation;
+    gp_Trsf transformation = location.Transformation ();
+    bool isReversed = (face.Orientation () == TopAbs_REVERSED);
+    return [faceTriangulation, transformation, isReversed](double* positions, double* normals, std::uint32_t* indices, std::uint32_t vertexOffset) {
+        for (Standard_Integer nodeIndex = 1; nodeIndex <= faceTriangulation->NbNodes (); nodeIndex++) {
+            gp_Pnt vertex = faceTriangulation->Node (nodeIndex).Transformed (transformation);
+            double* position = positions + (nodeIndex - 1) * 3;
+            position[0] = vertex.X ();
+            position[1] = vertex.Y ();
+            position[2] = vertex.Z ();
+        }
+
+        if (normals != nullptr && !faceTriangulation->HasNormals ()) {
+            WriteTriangleNormals (faceTriangulation, transformation, isReversed ? -1.0 : 1.0, normals);
+        } else if (normals != nullptr) {
+            double sign = isReversed ? -1.0 : 1.0;
+            for (Standard_Integer nodeIndex = 1; nodeIndex <= faceTriangulation->NbNodes (); nodeIndex++) {
+                gp_Dir direction = faceTriangulation->Normal (nodeIndex).Transformed (transformation);
+                double* normal = normals + (nodeIndex - 1) * 3;
+                normal[0] = sign * direction.X ();
+                normal[1] = sign * direction.Y ();
+                normal[2] = sign * direction.Z ();
+            }
+        }
+
+        for (Standard_Integer triangleIndex = 1; triangleIndex <= faceTriangulation->NbTriangles (); triangleIndex++) {
+            Poly_Triangle triangle = faceTriangulation->Triangle (triangleIndex);
+            std::uint32_t* index = indices + (triangleIndex - 1) * 3;
+            index[0] = vertexOffset + triangle (1) - 1;
+            index[1] = vertexOffset + (isReversed ? triangle (3) : triangle (2)) - 1;
+            index[2] = vertexOffset + (isReversed ? triangle (2) : triangle (3)) - 1;
+        }
+    };
+}
+
 bool OcctFace::HasTriangulation () const
 {
     if (triangulation.IsNull () || triangulation->NbNodes () == 0 || triangulation->NbTriangles () == 0) {
@@ -115,14 +206,13 @@ UnitsMethods_LengthUnit LinearUnitToLengthUnit (ImportParams::LinearUnit linearU
     }
 }
 
-bool TriangulateShape (TopoDS_Shape& shape, const ImportParams& params)
+static bool GetLinearDeflection (const TopoDS_Shape& shape, const ImportParams& params, Standard_Real& linDeflection)
 {
-    Standard_Real linDeflection = params.linearDeflection;
-    Standard_Real angDeflection = params.angularDeflection;
-
+    linDeflection = params.linearDeflection;
     if (params.linearDeflectionType == ImportParams::LinearDeflectionType::BoundingBoxRatio) {
+        // shapes without geometry (e.g. tessellated faces) can be measured by their triangulation only
         Bnd_Box boundingBox;
-        BRepBndLib::Add (shape, boundingBox, false);
+        BRepBndLib::Add (shape, boundingBox, params.reuseTriangulation);
         if (boundingBox.IsVoid ()) {
             return false;
         }
@@ -140,7 +230,317 @@ bool TriangulateShape (TopoDS_Shape& shape, const ImportParams& params)
             linDeflection = 1.0 * mmToUnit;
         }
     }
+    return true;
+}
+
+static bool HasSufficientTriangulation (const TopoDS_Face& face, Standard_Real linDeflection)
+{
+    // only the linear deflection is stored in the triangulation, the angular one can't be checked;
+    // zero deflection means unknown, it is typical for tessellated geometry without surfaces
+    TopLoc_Location location;
+    const Handle (Poly_Triangulation)& triangulation = BRep_Tool::Triangulation (face, location);
+    if (triangulation.IsNull () || triangulation->NbTriangles () == 0) {
+        return false;
+    }
+    return triangulation->Deflection () <= linDeflection;
+}
+
+// parameters of the triangle budget mode, all of them are relative to the size of the meshed part
+static const Standard_Real BudgetCoarseDeflectionRatio = 0.02;
+static const Standard_Real BudgetMinDeflectionRatio = 0.0002;
+static const Standard_Real BudgetMaxDeflectionRatio = 0.1;
+static const double BudgetTolerance = 0.1;
+static const int BudgetMaxRefinements = 2;
+
+class BudgetPart
+{
+public:
+    BudgetPart (const TopoDS_Shape& shape, Standard_Real size) :
+        shape (shape),
+        size (size),
+        fixedTriangles (0.0),
+        variableTriangles (0.0),
+        meshedDeflection (0.0)
+    {
+
+    }
+
+    Standard_Real GetDeflection (Standard_Real deflection) const
+    {
+        return std::min (std::max (deflection, size * BudgetMinDeflectionRatio), size * BudgetMaxDeflectionRatio);
+    }
+
+    double EstimateTriangles (Standard_Real deflection) const
+    {
+        // the triangle count of curved surfaces is roughly inversely proportional to the deflection,
+        // while planar faces have the same number of triangles with any deflection
+        return fixedTriangles + variableTriangles * (size * BudgetCoarseDeflectionRatio) / GetDeflection (deflection);
+    }
+
+    TopoDS_Shape shape;
+    Standard_Real size;
+    double fixedTriangles;
+    double variableTriangles;
+    Standard_Real meshedDeflection;
+};
+
+static Standard_Real GetShapeSize (const TopoDS_Shape& shape)
+{
+    Bnd_Box boundingBox;
+    BRepBndLib::Add (shape, boundingBox, false);
+    if (boundingBox.IsVoid ()) {
+        return 0.0;
+    }
+
+    Standard_Real xMin, yMin, zMin, xMax, yMax, zMax;
+    boundingBox.Get (xMin, yMin, zMin, xMax, yMax, zMax);
+    return ((xMax - xMin) + (yMax - yMin) + (zMax - zMin)) / 3.0;
+}
+
+static int CountTriangles (const TopoDS_Shape& shape)
+{
+    int triangleCount = 0;
+    for (TopExp_Explorer ex (shape, TopAbs_FACE); ex.More (); ex.Next ()) {
+        TopLoc_Location location;
+        const Handle (Poly_Triangulation)& triangulation = BRep_Tool::Triangulation (TopoDS::Face (ex.Current ()), location);
+        if (!triangulation.IsNull ()) {
+            triangleCount += triangulation->NbTriangles ();
+        }
+    }
+    return triangleCount;
+}
+
+static void AddBudgetPart (const TopoDS_Shape& shape, std::vector<BudgetPart>& parts)
+{
+    Standard_Real size = GetShapeSize (shape);
+    if (size < Precision::Confusion ()) {
+        return;
+    }
+    parts.push_back (BudgetPart (shape, size));
+}
+
+static void CollectBudgetParts (const TopoDS_Shape& shape, std::vector<BudgetPart>& parts)
+{
+    // parts are the same as the meshes of the output: solids, free shells and free faces
+    for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        AddBudgetPart (ex.Current (), parts);
+    }
+    for (TopExp_Explorer ex (shape, TopAbs_SHELL, TopAbs_SOLID); ex.More (); ex.Next ()) {
+        AddBudgetPart (ex.Current (), parts);
+    }
+    for (TopExp_Explorer ex (shape, TopAbs_FACE, TopAbs_SHELL); ex.More (); ex.Next ()) {
+        AddBudgetPart (ex.Current (), parts);
+    }
+}
+
+static double EstimateTriangles (const std::vector<BudgetPart>& parts, Standard_Real deflection)
+{
+    double triangleCount = 0.0;
+    for (const BudgetPart& part : parts) {
+        triangleCount += part.EstimateTriangles (deflection);
+    }
+    return triangleCount;
+}
+
+static Standard_Real FindBudgetDeflection (const std::vector<BudgetPart>& parts, double triangleBudget)
+{
+    Standard_Real minDeflection = RealLast ();
+    Standard_Real maxDeflection = 0.0;
+    for (const BudgetPart& part : parts) {
+        minDeflection = std::min (minDeflection, part.size * BudgetMinDeflectionRatio);
+        maxDeflection = std::max (maxDeflection, part.size * BudgetMaxDeflectionRatio);
+    }
+
+    if (EstimateTriangles (parts, minDeflection) <= triangleBudget) {
+        return minDeflection;
+    }
+    if (EstimateTriangles (parts, maxDeflection) >= triangleBudget) {
+        return maxDeflection;
+    }
+
+    // the estimation is monotonic, so the deflection can be found by bisection
+    for (int iteration = 0; iteration < 50; iteration++) {
+        Standard_Real deflection = std::sqrt (minDeflection * maxDeflection);
+        if (EstimateTriangles (parts, deflection) > triangleBudget) {
+            minDeflection = deflection;
+        } else {
+            maxDeflection = deflection;
+        }
+    }
+    return maxDeflection;
+}
+
+static int MeshBudgetParts (std::vector<BudgetPart>& parts, Standard_Real deflection, Standard_Real angDeflection)
+{
+    // parts clamped to the same deflection as before keep their triangulation, the others
+    // are cleaned first, otherwise finer triangulations would be kept
+    int triangleCount = 0;
+    for (BudgetPart& part : parts) {
+        Standard_Real partDeflection = part.GetDeflection (deflection);
+        if (partDeflection != part.meshedDeflection) {
+            BRepTools::Clean (part.shape);
+            BRepMesh_IncrementalMesh mesh (part.shape, partDeflection, Standard_False, angDeflection);
+            part.meshedDeflection = partDeflection;
+        }
+        triangleCount += CountTriangles (part.shape);
+    }
+    return triangleCount;
+}
+
+static bool TriangulateShapeWithBudget (TopoDS_Shape& shape, const ImportParams& params)
+{
+    std::vector<BudgetPart> parts;
+    CollectBudgetParts (shape, parts);
+    if (parts.empty ()) {
+        return false;
+    }
+
+    // coarse pre-pass with two different deflections to estimate how the triangle count of each part
+    // depends on the deflection, the second pass is finer, so the first triangulation is replaced
+    Standard_Real angDeflection = params.angularDeflection;
+    for (BudgetPart& part : parts) {
+        Standard_Real coarseDeflection = part.size * BudgetCoarseDeflectionRatio;
+        BRepMesh_IncrementalMesh coarseMesh (part.shape, coarseDeflection, Standard_False, angDeflection);
+        double coarseTriangles = CountTriangles (part.shape);
+        BRepMesh_IncrementalMesh finerMesh (part.shape, coarseDeflection / 2.0, Standard_False, angDeflection);
+        double finerTriangles = CountTriangles (part.shape);
+        part.meshedDeflection = coarseDeflection / 2.0;
+        part.variableTriangles = std::max (finerTriangles - coarseTriangles, 0.0);
+        part.fixedTriangles = std::max (coarseTriangles - part.variableTriangles, 0.0);
+    }
+
+    double triangleBudget = std::max (params.triangleBudget, 1);
+    Standard_Real deflection = FindBudgetDeflection (parts, triangleBudget);
+    for (int refinement = 0; ; refinement++) {
+        double triangleCount = MeshBudgetParts (parts, deflection, angDeflection);
+        if (refinement == BudgetMaxRefinements || std::abs (triangleCount - triangleBudget) <= triangleBudget * BudgetTolerance) {
+            break;
+        }
+
+        // scale the estimation of the curved surfaces based on the real result
+        double fixedTriangles = 0.0;
+        for (const BudgetPart& part : parts) {
+            fixedTriangles += part.fixedTriangles;
+        }
+        double estimatedVariableTriangles = EstimateTriangles (parts, deflection) - fixedTriangles;
+        double realVariableTriangles = triangleCount - fixedTriangles;
+        if (estimatedVariableTriangles <= 0.0 || realVariableTriangles <= 0.0) {
+            break;
+        }
+        for (BudgetPart& part : parts) {
+            part.variableTriangles *= realVariableTriangles / estimatedVariableTriangles;
+        }
+        deflection = FindBudgetDeflection (parts, triangleBudget);
+    }
 
-    BRepMesh_IncrementalMesh mesh (shape, linDeflection, Standard_False, angDeflection);
     return true;
 }
+
+static void ComputeNormals (const TopoDS_Shape& shape)
+{
+    // instanced faces share the same triangulation, so every triangulation is processed only once
+    std::vector<Handle (Poly_Triangulation)> triangulations;
+    std::unordered_set<const Poly_Triangulation*> visited;
+    for (TopExp_Explorer ex (shape, TopAbs_FACE); ex.More (); ex.Next ()) {
+        TopLoc_Location location;
+        const Handle (Poly_Triangulation)& triangulation = BRep_Tool::Triangulation (TopoDS::Face (ex.Current ()), location);
+        if (triangulation.IsNull () || triangulation->NbNodes () == 0 || triangulation->HasNormals ()) {
+            continue;
+        }
+        if (visited.insert (triangulation.get ()).second) {
+            triangulations.push_back (triangulation);
+        }
+    }
+
+    OSD_Parallel::For (0, (int) triangulations.size (), [&](int index) {
+        triangulations[index]->ComputeNormals ();
+    });
+}
+
+static bool MeshShape (TopoDS_Shape& shape, const ImportParams& params, const SolidDeduplicator& deduplicator)
+{
+    if (params.linearDeflectionType == ImportParams::LinearDeflectionType::TriangleBudget) {
+        if (TriangulateShapeWithBudget (shape, params)) {
+            return true;
+        }
+        // without parts of measurable size there is nothing to distribute the budget among,
+        // so the shape is triangulated with the default deflection
+        ImportParams defaultParams;
+        ImportParams fallbackParams = params;
+        fallbackParams.linearDeflectionType = defaultParams.linearDeflectionType;
+        fallbackParams.linearDeflection = defaultParams.linearDeflection;
+        return MeshShape (shape, fallbackParams, deduplicator);
+    }
+
+    Standard_Real linDeflection = 0.0;
+    Standard_Real angDeflection = params.angularDeflection;
+    if (!GetLinearDeflection (shape, params, linDeflection)) {
+        return false;
+    }
+
+    // duplicated solids get the triangulation of their prototype after meshing,
+    // and solids of a previous import are not triangulated again
+    TopoDS_Shape shapeToMesh = deduplicator.RemoveDuplicates (shape);
+    if (params.meshReuse != nullptr) {
+        shapeToMesh = params.meshReuse->RemoveReusableParts (shapeToMesh, params, linDeflection);
+    }
+    if (params.reuseTriangulation) {
+        BRep_Builder builder;
+        TopoDS_Compound facesToMesh;
+        builder.MakeCompound (facesToMesh);
+        bool hasFaceToMesh = false;
+        for (TopExp_Explorer ex (shapeToMesh, TopAbs_FACE); ex.More (); ex.Next ()) {
+            const TopoDS_Face& face = TopoDS::Face (ex.Current ());
+            if (!HasSufficientTriangulation (face, linDeflection)) {
+                builder.Add (facesToMesh, face);
+                hasFaceToMesh = true;
+            }
+        }
+        if (hasFaceToMesh) {
+            BRepMesh_IncrementalMesh mesh (facesToMesh, linDeflection, Standard_False, angDeflection);
+        }
+        return true;
+    }
+
+    BRepMesh_IncrementalMesh mesh (shapeToMesh, linDeflection, Standard_False, angDeflection);
+    return true;
+}
+
+bool TriangulateShape (TopoDS_Shape& shape, const ImportParams& params)
+{
+    SolidDeduplicator deduplicator (params);
+    return TriangulateShape (shape, params, deduplicator);
+}
+
+bool TriangulateShape (TopoDS_Shape& shape, const ImportParams& params, const SolidDeduplicator& deduplicator)
+{
+    TraceScope triangulateScope (params.tracer, "TriangulateShape");
+    if (params.tracer != nullptr) {
+        int faceCount = 0;
+        for (TopExp_Explorer ex (shape, TopAbs_FACE); ex.More (); ex.Next ()) {
+            faceCount += 1;
+        }
+        triangulateScope.AddArg ("faces", faceCount);
+    }
+
+    {
+        TraceScope meshScope (params.tracer, "MeshShape");
+        if (!MeshShape (shape, params, deduplicator)) {
+            return false;
+        }
+    }
+
+    if (params.computeNormals) {
+        TraceScope normalsScope (params.tracer, "ComputeNormals");
+        ComputeNormals (shape);
+    }
+    return true;
+}
+
+void ReleaseImporter (ImporterPtr& importer)
+{
+    // OCCT has one global memory manager, so the objects of the import can't be freed at once,
+    // but the pooled allocator (MMGT_OPT=1) can give the freed blocks back after the import
+    importer = nullptr;
+    Standard::Purge ();
+}
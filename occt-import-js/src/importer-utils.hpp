@@ -11,11 +11,7 @@
 #include <vector>
 #include <fstream>
 
-class VectorBuffer : public std::streambuf
-{
-public:
-    VectorBuffer (const std::vector<uint8_t>& v);
-};
+class SolidDeduplicator;
 
 class OcctFace : public Face
 {
@@ -29,6 +25,10 @@ public:
     virtual void EnumerateNormals (const std::function<void (double, double, double)>& onNormal) const override;
     virtual void EnumerateTriangles (const std::function<void (int, int, int)>& onTriangle) const override;
 
+    virtual int GetVertexCount () const override;
+    virtual int GetTriangleCount () const override;
+    virtual FaceWriter GetWriter () const override;
+
 protected:
     bool HasTriangulation () const;
 
@@ -39,3 +39,5 @@ protected:
 
 UnitsMethods_LengthUnit LinearUnitToLengthUnit (ImportParams::LinearUnit linearUnit);
 bool TriangulateShape (TopoDS_Shape& shape, const ImportParams& params);
+bool TriangulateShape (TopoDS_Shape& shape, const ImportParams& params, const SolidDeduplicator& deduplicator);
+void ReleaseImporter (ImporterPtr& importer);
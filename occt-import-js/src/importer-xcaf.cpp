@@ -1,15 +1,37 @@
 #include "importer-xcaf.hpp"
 #include "importer-utils.hpp"
+#include "importer-decompress.hpp"
+#include "importer-dedup.hpp"
+#include "importer-reuse.hpp"
+#include "importer-filter.hpp"
+#include "importer-trace.hpp"
 
 #include <TopExp_Explorer.hxx>
 #include <TopoDS.hxx>
 #include <TopoDS_Face.hxx>
+#include <TopoDS_Compound.hxx>
+#include <BRep_Builder.hxx>
 #include <TDF_ChildIterator.hxx>
+#include <TDF_Tool.hxx>
 #include <TDocStd_Document.hxx>
 #include <TDataStd_Name.hxx>
 #include <Quantity_Color.hxx>
 #include <BRep_Tool.hxx>
 #include <XCAFDoc_DocumentTool.hxx>
+#include <XCAFDoc_DataMapOfShapeLabel.hxx>
+#include <TDF_LabelSequence.hxx>
+#include <TDF_LabelMap.hxx>
+#include <TCollection_ExtendedString.hxx>
+
+static std::string ExtendedStringToUtf8 (const TCollection_ExtendedString& str)
+{
+    Standard_Integer utf8Length = str.LengthOfCString ();
+    char* utf8Buf = new char[utf8Length + 1];
+    str.ToUTF8CString (utf8Buf);
+    std::string result (utf8Buf, utf8Length);
+    delete[] utf8Buf;
+    return result;
+}
 
 static std::string GetLabelNameNoRef (const TDF_Label& label)
 {
@@ -18,12 +40,7 @@ static std::string GetLabelNameNoRef (const TDF_Label& label)
         return std::string ();
     }
 
-    Standard_Integer utf8NameLength = nameAttribute->Get ().LengthOfCString ();
-    char* nameBuf = new char[utf8NameLength + 1];
-    nameAttribute->Get ().ToUTF8CString (nameBuf);
-    std::string name (nameBuf, utf8NameLength);
-    delete[] nameBuf;
-    return name;
+    return ExtendedStringToUtf8 (nameAttribute->Get ());
 }
 
 static std::string GetLabelName (const TDF_Label& label, const Handle (XCAFDoc_ShapeTool)& shapeTool)
@@ -94,6 +111,377 @@ static bool IsFreeShape (const TDF_Label& label, const Handle (XCAFDoc_ShapeTool
     return shapeTool->GetShape (label, tmpShape) && shapeTool->IsFree (label);
 }
 
+static bool IsMeshLabel (const TDF_Label& label, const Handle (XCAFDoc_ShapeTool)& shapeTool)
+{
+    // if there are no children, it is a mesh node
+    if (!label.HasChild ()) {
+        return true;
+    }
+
+    // if it has a subshape child, treat it as mesh node
+    bool hasSubShapeChild = false;
+    for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
+        TDF_Label childLabel = it.Value ();
+        if (shapeTool->IsSubShape (childLabel)) {
+            hasSubShapeChild = true;
+            break;
+        }
+    }
+    if (hasSubShapeChild) {
+        return true;
+    }
+
+    // if it doesn't have a freeshape child, treat it as a mesh node
+    bool hasFreeShapeChild = false;
+    for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
+        TDF_Label childLabel = it.Value ();
+        if (IsFreeShape (childLabel, shapeTool)) {
+            hasFreeShapeChild = true;
+            break;
+        }
+    }
+    if (!hasFreeShapeChild) {
+        return true;
+    }
+
+    return false;
+}
+
+static std::string GetLabelEntry (const TDF_Label& label)
+{
+    TCollection_AsciiString entry;
+    TDF_Tool::Entry (label, entry);
+    return entry.ToCString ();
+}
+
+static std::string GetChildPath (const std::string& parentPath, const std::string& childName)
+{
+    return parentPath.empty () ? childName : parentPath + "/" + childName;
+}
+
+enum class FilterResult
+{
+    Excluded,
+    Included,
+    HasIncludedChild
+};
+
+class XcafNodeShapeLabels
+{
+public:
+    XcafNodeShapeLabels () :
+        shapeLabels (),
+        nodeLayers ()
+    {
+
+    }
+
+    XCAFDoc_DataMapOfShapeLabel shapeLabels;
+    std::vector<std::string> nodeLayers;
+};
+
+class XcafShapeFilter
+{
+public:
+    XcafShapeFilter (const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool, const Handle (XCAFDoc_LayerTool)& layerTool, const ImportParams& params) :
+        shapeTool (shapeTool),
+        colorTool (colorTool),
+        layerTool (layerTool),
+        params (params),
+        labelsWithIncludedChild ()
+    {
+        // the labels with an included descendant are collected in a single pass over the document
+        if (!params.includeNodes.empty ()) {
+            for (TDF_ChildIterator it (shapeTool->Label ()); it.More (); it.Next ()) {
+                TDF_Label childLabel = it.Value ();
+                if (IsFreeShape (childLabel, shapeTool)) {
+                    CollectLabelsWithIncludedChild (childLabel, GetLabelName (childLabel, shapeTool));
+                }
+            }
+        }
+    }
+
+    bool IsEnabled () const
+    {
+        return HasNodeFilter () || HasShapeFilter ();
+    }
+
+    FilterResult FilterLabel (const TDF_Label& label, const std::string& path, bool isParentIncluded) const
+    {
+        std::vector<std::string> values = GetLabelValues (label, path);
+        if (IsExcludedLabel (label, values)) {
+            return FilterResult::Excluded;
+        }
+        if (isParentIncluded || params.includeNodes.empty () || MatchAnyPattern (params.includeNodes, values)) {
+            return FilterResult::Included;
+        }
+
+        // the node is kept without its meshes if one of its descendants is included
+        if (labelsWithIncludedChild.Contains (label)) {
+            return FilterResult::HasIncludedChild;
+        }
+        return FilterResult::Excluded;
+    }
+
+    XcafNodeShapeLabels GetShapeLabels (const TDF_Label& nodeLabel) const
+    {
+        XcafNodeShapeLabels nodeShapeLabels;
+        if (!HasShapeFilter ()) {
+            return nodeShapeLabels;
+        }
+
+        // the parts of a node can only be labeled under the node or under its referred shape,
+        // so they are collected from there once instead of searching the document for every part
+        TopoDS_Shape nodeShape;
+        if (shapeTool->GetShape (nodeLabel, nodeShape)) {
+            nodeShapeLabels.shapeLabels.Bind (nodeShape, nodeLabel);
+        }
+        AddSubShapeLabels (nodeLabel, TopLoc_Location (), nodeShapeLabels.shapeLabels);
+        if (XCAFDoc_ShapeTool::IsReference (nodeLabel)) {
+            TDF_Label referredShapeLabel;
+            shapeTool->GetReferredShape (nodeLabel, referredShapeLabel);
+            AddSubShapeLabels (referredShapeLabel, XCAFDoc_ShapeTool::GetLocation (nodeLabel), nodeShapeLabels.shapeLabels);
+        }
+
+        // the layers of the node and its ancestors are inherited by the shape
+        if (!params.includeLayers.empty ()) {
+            bool isOnHiddenLayer = false;
+            for (TDF_Label label = nodeLabel; !label.IsNull () && label != shapeTool->Label (); label = label.Father ()) {
+                GetLayers (label, nodeShapeLabels.nodeLayers, isOnHiddenLayer);
+            }
+        }
+        return nodeShapeLabels;
+    }
+
+    bool IsVisibleShape (const TopoDS_Shape& shape, const XcafNodeShapeLabels& nodeShapeLabels) const
+    {
+        if (!HasShapeFilter ()) {
+            return true;
+        }
+
+        const TDF_Label* shapeLabel = nodeShapeLabels.shapeLabels.Seek (shape);
+        if (shapeLabel != nullptr && IsHiddenLabel (*shapeLabel)) {
+            return false;
+        }
+        if (params.includeLayers.empty ()) {
+            return true;
+        }
+
+        std::vector<std::string> layers = nodeShapeLabels.nodeLayers;
+        bool isOnHiddenLayer = false;
+        if (shapeLabel != nullptr) {
+            GetLayers (*shapeLabel, layers, isOnHiddenLayer);
+        }
+        return MatchAnyPattern (params.includeLayers, layers);
+    }
+
+    TopoDS_Shape GetFilteredShape (const TDF_Label& label) const
+    {
+        if (!IsEnabled ()) {
+            return shapeTool->GetShape (label);
+        }
+
+        // only the meshes of the remaining nodes are triangulated
+        BRep_Builder builder;
+        TopoDS_Compound shapes;
+        builder.MakeCompound (shapes);
+        AddFilteredShapes (label, GetLabelName (label, shapeTool), false, builder, shapes);
+        return shapes;
+    }
+
+    TopoDS_Shape GetVisibleFaces (const TopoDS_Shape& shape, const XcafNodeShapeLabels& nodeShapeLabels) const
+    {
+        if (!HasShapeFilter ()) {
+            return shape;
+        }
+
+        BRep_Builder builder;
+        TopoDS_Compound faces;
+        builder.MakeCompound (faces);
+        for (TopExp_Explorer ex (shape, TopAbs_FACE, TopAbs_SHELL); ex.More (); ex.Next ()) {
+            if (IsVisibleShape (ex.Current (), nodeShapeLabels)) {
+                builder.Add (faces, ex.Current ());
+            }
+        }
+        return faces;
+    }
+
+private:
+    void AddSubShapeLabels (const TDF_Label& label, const TopLoc_Location& location, XCAFDoc_DataMapOfShapeLabel& shapeLabels) const
+    {
+        for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
+            TDF_Label childLabel = it.Value ();
+            TopoDS_Shape subShape;
+            if (shapeTool->IsSubShape (childLabel) && shapeTool->GetShape (childLabel, subShape)) {
+                shapeLabels.Bind (subShape.Moved (location), childLabel);
+            }
+        }
+    }
+
+    bool CollectLabelsWithIncludedChild (const TDF_Label& label, const std::string& path)
+    {
+        // post-order pass, returns if the label is kept when its parent is not included,
+        // the descendants of an included label are included anyway, so they are not visited
+        std::vector<std::string> values = GetLabelValues (label, path);
+        if (IsExcludedLabel (label, values)) {
+            return false;
+        }
+        if (MatchAnyPattern (params.includeNodes, values)) {
+            return true;
+        }
+        if (IsMeshLabel (label, shapeTool)) {
+            return false;
+        }
+
+        bool hasIncludedChild = false;
+        for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
+            TDF_Label childLabel = it.Value ();
+            if (!IsFreeShape (childLabel, shapeTool)) {
+                continue;
+            }
+            std::string childPath = GetChildPath (path, GetLabelName (childLabel, shapeTool));
+            if (CollectLabelsWithIncludedChild (childLabel, childPath)) {
+                hasIncludedChild = true;
+            }
+        }
+        if (hasIncludedChild) {
+            labelsWithIncludedChild.Add (label);
+        }
+        return hasIncludedChild;
+    }
+
+    std::vector<std::string> GetLabelValues (const TDF_Label& label, const std::string& path) const
+    {
+        std::vector<std::string> values = { GetLabelName (label, shapeTool), path, GetLabelEntry (label) };
+        if (XCAFDoc_ShapeTool::IsReference (label)) {
+            TDF_Label referredShapeLabel;
+            shapeTool->GetReferredShape (label, referredShapeLabel);
+            values.push_back (GetLabelEntry (referredShapeLabel));
+        }
+        return values;
+    }
+
+    bool IsExcludedLabel (const TDF_Label& label, const std::vector<std::string>& values) const
+    {
+        return IsHiddenLabel (label) || MatchAnyPattern (params.excludeNodes, values);
+    }
+
+    bool HasNodeFilter () const
+    {
+        return !params.includeNodes.empty () || !params.excludeNodes.empty ();
+    }
+
+    bool HasShapeFilter () const
+    {
+        return params.skipHiddenShapes || !params.includeLayers.empty () || !params.excludeLayers.empty ();
+    }
+
+    void GetLayers (const TDF_Label& label, std::vector<std::string>& layers, bool& isOnHiddenLayer) const
+    {
+        // the layers can be assigned to the instance or to the referred product
+        std::vector<TDF_Label> labels = { label };
+        if (XCAFDoc_ShapeTool::IsReference (label)) {
+            TDF_Label referredShapeLabel;
+            shapeTool->GetReferredShape (label, referredShapeLabel);
+            labels.push_back (referredShapeLabel);
+        }
+
+        for (const TDF_Label& currentLabel : labels) {
+            TDF_LabelSequence layerLabels;
+            if (!layerTool->GetLayers (currentLabel, layerLabels)) {
+                continue;
+            }
+            for (Standard_Integer layerIndex = 1; layerIndex <= layerLabels.Length (); layerIndex++) {
+                const TDF_Label& layerLabel = layerLabels.Value (layerIndex);
+                TCollection_ExtendedString layerName;
+                if (layerTool->GetLayer (layerLabel, layerName)) {
+                    layers.push_back (ExtendedStringToUtf8 (layerName));
+                }
+                if (!layerTool->IsVisible (layerLabel)) {
+                    isOnHiddenLayer = true;
+                }
+            }
+        }
+    }
+
+    bool IsHiddenLabel (const TDF_Label& label) const
+    {
+        if (!HasShapeFilter ()) {
+            return false;
+        }
+
+        if (params.skipHiddenShapes) {
+            if (!colorTool->IsVisible (label)) {
+                return true;
+            }
+            if (XCAFDoc_ShapeTool::IsReference (label)) {
+                TDF_Label referredShapeLabel;
+                shapeTool->GetReferredShape (label, referredShapeLabel);
+                if (!colorTool->IsVisible (referredShapeLabel)) {
+                    return true;
+                }
+            }
+        }
+
+        std::vector<std::string> layers;
+        bool isOnHiddenLayer = false;
+        GetLayers (label, layers, isOnHiddenLayer);
+        if (params.skipHiddenShapes && isOnHiddenLayer) {
+            return true;
+        }
+        return MatchAnyPattern (params.excludeLayers, layers);
+    }
+
+    void AddFilteredShapes (const TDF_Label& label, const std::string& path, bool isParentIncluded, BRep_Builder& builder, TopoDS_Compound& shapes) const
+    {
+        FilterResult filterResult = FilterLabel (label, path, isParentIncluded);
+        if (filterResult == FilterResult::Excluded) {
+            return;
+        }
+        if (IsMeshLabel (label, shapeTool)) {
+            AddVisibleShapes (label, builder, shapes);
+            return;
+        }
+        for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
+            TDF_Label childLabel = it.Value ();
+            if (IsFreeShape (childLabel, shapeTool)) {
+                std::string childPath = GetChildPath (path, GetLabelName (childLabel, shapeTool));
+                AddFilteredShapes (childLabel, childPath, filterResult == FilterResult::Included, builder, shapes);
+            }
+        }
+    }
+
+    void AddVisibleShapes (const TDF_Label& label, BRep_Builder& builder, TopoDS_Compound& shapes) const
+    {
+        // the same parts as the meshes of the node: solids, free shells and free faces
+        TopoDS_Shape shape = shapeTool->GetShape (label);
+        if (!HasShapeFilter ()) {
+            builder.Add (shapes, shape);
+            return;
+        }
+        XcafNodeShapeLabels nodeShapeLabels = GetShapeLabels (label);
+        for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
+            if (IsVisibleShape (ex.Current (), nodeShapeLabels)) {
+                builder.Add (shapes, ex.Current ());
+            }
+        }
+        for (TopExp_Explorer ex (shape, TopAbs_SHELL, TopAbs_SOLID); ex.More (); ex.Next ()) {
+            if (IsVisibleShape (ex.Current (), nodeShapeLabels)) {
+                builder.Add (shapes, ex.Current ());
+            }
+        }
+        builder.Add (shapes, GetVisibleFaces (shape, nodeShapeLabels));
+    }
+
+    const Handle (XCAFDoc_ShapeTool)& shapeTool;
+    const Handle (XCAFDoc_ColorTool)& colorTool;
+    const Handle (XCAFDoc_LayerTool)& layerTool;
+    const ImportParams& params;
+    TDF_LabelMap labelsWithIncludedChild;
+};
+
+using XcafShapeFilterPtr = std::shared_ptr<const XcafShapeFilter>;
+
 class XcafFace : public OcctFace
 {
 public:
@@ -118,11 +506,12 @@ private:
 class XcafShapeMesh : public Mesh
 {
 public:
-    XcafShapeMesh (const TopoDS_Shape& shape, const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool) :
+    XcafShapeMesh (const TopoDS_Shape& shape, const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool, const ImportParams& params) :
         Mesh (),
         shape (shape),
         shapeTool (shapeTool),
-        colorTool (colorTool)
+        colorTool (colorTool),
+        params (params)
     {
 
     }
@@ -132,6 +521,14 @@ public:
         return GetShapeName (shape, shapeTool);
     }
 
+    virtual std::string GetShapeKey () const override
+    {
+        if (params.meshReuse == nullptr) {
+            return std::string ();
+        }
+        return params.meshReuse->GetShapeKey (shape);
+    }
+
     virtual bool GetColor (Color& color) const override
     {
         return GetShapeColor (shape, shapeTool, colorTool, color);
@@ -150,6 +547,7 @@ private:
     const TopoDS_Shape& shape;
     const Handle (XCAFDoc_ShapeTool)& shapeTool;
     const Handle (XCAFDoc_ColorTool)& colorTool;
+    const ImportParams& params;
 };
 
 class XcafStandaloneFacesMesh : public Mesh
@@ -175,6 +573,11 @@ public:
         return std::string ();
     }
 
+    virtual std::string GetShapeKey () const override
+    {
+        return std::string ();
+    }
+
     virtual bool GetColor (Color&) const override
     {
         return false;
@@ -198,10 +601,14 @@ private:
 class XcafNode : public Node
 {
 public:
-    XcafNode (const TDF_Label& label, const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool) :
+    XcafNode (const TDF_Label& label, const std::string& path, bool isIncluded, const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool, const XcafShapeFilterPtr& filter, const ImportParams& params) :
         label (label),
+        path (path),
+        isIncluded (isIncluded),
         shapeTool (shapeTool),
-        colorTool (colorTool)
+        colorTool (colorTool),
+        filter (filter),
+        params (params)
     {
 
     }
@@ -220,49 +627,24 @@ public:
         std::vector<NodePtr> children;
         for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
             TDF_Label childLabel = it.Value ();
-            if (IsFreeShape (childLabel, shapeTool)) {
-                children.push_back (std::make_shared<const XcafNode> (
-                    childLabel, shapeTool, colorTool
-                    ));
+            if (!IsFreeShape (childLabel, shapeTool)) {
+                continue;
+            }
+            std::string childPath = GetChildPath (path, GetLabelName (childLabel, shapeTool));
+            FilterResult filterResult = filter->FilterLabel (childLabel, childPath, isIncluded);
+            if (filterResult == FilterResult::Excluded) {
+                continue;
             }
+            children.push_back (std::make_shared<const XcafNode> (
+                childLabel, childPath, filterResult == FilterResult::Included, shapeTool, colorTool, filter, params
+                ));
         }
         return children;
     }
 
     virtual bool IsMeshNode () const override
     {
-        // if there are no children, it is a mesh node
-        if (!label.HasChild ()) {
-            return true;
-        }
-
-        // if it has a subshape child, treat it as mesh node
-        bool hasSubShapeChild = false;
-        for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
-            TDF_Label childLabel = it.Value ();
-            if (shapeTool->IsSubShape (childLabel)) {
-                hasSubShapeChild = true;
-                break;
-            }
-        }
-        if (hasSubShapeChild) {
-            return true;
-        }
-
-        // if it doesn't have a freeshape child, treat it as a mesh node
-        bool hasFreeShapeChild = false;
-        for (TDF_ChildIterator it (label); it.More (); it.Next ()) {
-            TDF_Label childLabel = it.Value ();
-            if (IsFreeShape (childLabel, shapeTool)) {
-                hasFreeShapeChild = true;
-                break;
-            }
-        }
-        if (!hasFreeShapeChild) {
-            return true;
-        }
-
-        return false;
+        return IsMeshLabel (label, shapeTool);
     }
 
     virtual void EnumerateMeshes (const std::function<void (const Mesh&)>& onMesh) const override
@@ -278,38 +660,52 @@ public:
 private:
     void EnumerateShapeMeshes (const TopoDS_Shape& shape, const std::function<void (const Mesh&)>& onMesh) const
     {
+        XcafNodeShapeLabels nodeShapeLabels = filter->GetShapeLabels (label);
+
         // Enumerate solids
         for (TopExp_Explorer ex (shape, TopAbs_SOLID); ex.More (); ex.Next ()) {
             const TopoDS_Shape& currentShape = ex.Current ();
-            XcafShapeMesh outputShapeMesh (currentShape, shapeTool, colorTool);
+            if (!filter->IsVisibleShape (currentShape, nodeShapeLabels)) {
+                continue;
+            }
+            XcafShapeMesh outputShapeMesh (currentShape, shapeTool, colorTool, params);
             onMesh (outputShapeMesh);
         }
 
         // Enumerate shells that are not part of a solid
         for (TopExp_Explorer ex (shape, TopAbs_SHELL, TopAbs_SOLID); ex.More (); ex.Next ()) {
             const TopoDS_Shape& currentShape = ex.Current ();
-            XcafShapeMesh outputShapeMesh (currentShape, shapeTool, colorTool);
+            if (!filter->IsVisibleShape (currentShape, nodeShapeLabels)) {
+                continue;
+            }
+            XcafShapeMesh outputShapeMesh (currentShape, shapeTool, colorTool, params);
             onMesh (outputShapeMesh);
         }
 
         // Create a mesh from faces that are not part of a shell
-        XcafStandaloneFacesMesh standaloneFacesMesh (shape, shapeTool, colorTool);
+        TopoDS_Shape visibleFaces = filter->GetVisibleFaces (shape, nodeShapeLabels);
+        XcafStandaloneFacesMesh standaloneFacesMesh (visibleFaces, shapeTool, colorTool);
         if (standaloneFacesMesh.HasFaces ()) {
             onMesh (standaloneFacesMesh);
         }
     }
 
     TDF_Label label;
+    std::string path;
+    bool isIncluded;
     const Handle (XCAFDoc_ShapeTool)& shapeTool;
     const Handle (XCAFDoc_ColorTool)& colorTool;
+    XcafShapeFilterPtr filter;
+    const ImportParams& params;
 };
 
 class XcafRootNode : public Node
 {
 public:
-    XcafRootNode (const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool, const ImportParams& params) :
+    XcafRootNode (const Handle (XCAFDoc_ShapeTool)& shapeTool, const Handle (XCAFDoc_ColorTool)& colorTool, const Handle (XCAFDoc_LayerTool)& layerTool, const ImportParams& params) :
         shapeTool (shapeTool),
         colorTool (colorTool),
+        layerTool (layerTool),
         params (params)
     {
 
@@ -324,20 +720,70 @@ public:
     {
         TDF_Label mainLabel = shapeTool->Label ();
 
-        std::vector<NodePtr> children;
-        for (TDF_ChildIterator it (mainLabel); it.More (); it.Next ()) {
-            TDF_Label childLabel = it.Value ();
-            if (IsFreeShape (childLabel, shapeTool)) {
-                TopoDS_Shape shape = shapeTool->GetShape (childLabel);
-                if (!TriangulateShape (shape, params)) {
+        std::vector<TDF_Label> freeShapeLabels;
+        std::vector<FilterResult> filterResults;
+        std::vector<TopoDS_Shape> freeShapes;
+        XcafShapeFilterPtr filter;
+        {
+            // the filter is shared by all of the nodes, so it is prepared only once per import
+            TraceScope filterScope (params.tracer, "FilterShapes");
+            filter = std::make_shared<const XcafShapeFilter> (shapeTool, colorTool, layerTool, params);
+            for (TDF_ChildIterator it (mainLabel); it.More (); it.Next ()) {
+                TDF_Label childLabel = it.Value ();
+                if (!IsFreeShape (childLabel, shapeTool)) {
+                    continue;
+                }
+                FilterResult filterResult = filter->FilterLabel (childLabel, GetLabelName (childLabel, shapeTool), false);
+                if (filterResult == FilterResult::Excluded) {
                     continue;
                 }
-                children.push_back (std::make_shared<const XcafNode> (
-                    childLabel, shapeTool, colorTool
-                    ));
+                freeShapeLabels.push_back (childLabel);
+                filterResults.push_back (filterResult);
+                freeShapes.push_back (filter->GetFilteredShape (childLabel));
             }
+            filterScope.AddArg ("freeShapes", (int) freeShapes.size ());
         }
 
+        // the triangle budget is distributed among all of the free shapes
+        bool isBudgetMode = (params.linearDeflectionType == ImportParams::LinearDeflectionType::TriangleBudget);
+        bool isBudgetTriangulated = false;
+        if (isBudgetMode) {
+            BRep_Builder builder;
+            TopoDS_Compound allShapes;
+            builder.MakeCompound (allShapes);
+            for (const TopoDS_Shape& freeShape : freeShapes) {
+                builder.Add (allShapes, freeShape);
+            }
+            isBudgetTriangulated = TriangulateShape (allShapes, params);
+        }
+
+        // identical solids can be in different free shapes, so all of them are collected first
+        SolidDeduplicator deduplicator (params);
+        {
+            TraceScope deduplicateScope (params.tracer, "FindDuplicates");
+            for (const TopoDS_Shape& freeShape : freeShapes) {
+                deduplicator.AddShape (freeShape);
+            }
+        }
+
+        std::vector<NodePtr> children;
+        for (size_t labelIndex = 0; labelIndex < freeShapeLabels.size (); labelIndex++) {
+            const TDF_Label& freeShapeLabel = freeShapeLabels[labelIndex];
+            TraceScope freeShapeScope (params.tracer, "FreeShape");
+            if (params.tracer != nullptr) {
+                freeShapeScope.AddArg ("name", GetLabelName (freeShapeLabel, shapeTool));
+                freeShapeScope.AddArg ("label", GetLabelEntry (freeShapeLabel));
+            }
+            bool isTriangulated = isBudgetMode ? isBudgetTriangulated : TriangulateShape (freeShapes[labelIndex], params, deduplicator);
+            if (!isTriangulated) {
+                continue;
+            }
+            children.push_back (std::make_shared<const XcafNode> (
+                freeShapeLabel, GetLabelName (freeShapeLabel, shapeTool), filterResults[labelIndex] == FilterResult::Included, shapeTool, colorTool, filter, params
+                ));
+        }
+        deduplicator.TransferTriangulations ();
+
         return children;
     }
 
@@ -354,6 +800,7 @@ public:
 private:
     const Handle (XCAFDoc_ShapeTool)& shapeTool;
     const Handle (XCAFDoc_ColorTool)& colorTool;
+    const Handle (XCAFDoc_LayerTool)& layerTool;
     const ImportParams& params;
 };
 
@@ -362,25 +809,34 @@ ImporterXcaf::ImporterXcaf () :
     document (nullptr),
     shapeTool (nullptr),
     colorTool (nullptr),
+    layerTool (nullptr),
     rootNode (nullptr)
 {
 
 }
 
-Importer::Result ImporterXcaf::LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params)
+Importer::Result ImporterXcaf::LoadStream (std::istream& inputStream, const ImportParams& params)
 {
+    if (!params.IsValid ()) {
+        return Importer::Result::ImportFailed;
+    }
+
     document = new TDocStd_Document ("XmlXCAF");
 
     UnitsMethods_LengthUnit lengthUnit = LinearUnitToLengthUnit (params.linearUnit);
     XCAFDoc_DocumentTool::SetLengthUnit (document, 1.0, lengthUnit);
 
-    if (!TransferToDocument (fileContent)) {
+    bool transferred = ReadDecompressedStream (inputStream, [&] (std::istream& decompressedStream) {
+        return TransferToDocument (decompressedStream, params);
+    });
+    if (!transferred) {
         return Importer::Result::ImportFailed;
     }
 
     TDF_Label mainLabel = document->Main ();
     shapeTool = XCAFDoc_DocumentTool::ShapeTool (mainLabel);
     colorTool = XCAFDoc_DocumentTool::ColorTool (mainLabel);
+    layerTool = XCAFDoc_DocumentTool::LayerTool (mainLabel);
 
     TDF_LabelSequence labels;
     shapeTool->GetFreeShapes (labels);
@@ -388,7 +844,7 @@ Importer::Result ImporterXcaf::LoadFile (const std::vector<std::uint8_t>& fileCo
         return Importer::Result::ImportFailed;
     }
 
-    rootNode = std::make_shared<const XcafRootNode> (shapeTool, colorTool, params);
+    rootNode = std::make_shared<const XcafRootNode> (shapeTool, colorTool, layerTool, params);
     return Importer::Result::Success;
 }
 
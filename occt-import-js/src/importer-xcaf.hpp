@@ -5,20 +5,22 @@
 #include <TDocStd_Document.hxx>
 #include <XCAFDoc_ColorTool.hxx>
 #include <XCAFDoc_ShapeTool.hxx>
+#include <XCAFDoc_LayerTool.hxx>
 
 class ImporterXcaf : public Importer
 {
 public:
     ImporterXcaf ();
 
-    virtual Result LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params) override;
+    virtual Result LoadStream (std::istream& inputStream, const ImportParams& params) override;
     virtual NodePtr GetRootNode () const override;
 
 protected:
-    virtual bool TransferToDocument (const std::vector<std::uint8_t>& fileContent) = 0;
+    virtual bool TransferToDocument (std::istream& inputStream, const ImportParams& params) = 0;
 
     Handle (TDocStd_Document) document;
     Handle (XCAFDoc_ShapeTool) shapeTool;
     Handle (XCAFDoc_ColorTool) colorTool;
+    Handle (XCAFDoc_LayerTool) layerTool;
     NodePtr rootNode;
 };
@@ -52,11 +52,32 @@ ImportParams::ImportParams () :
     linearUnit (LinearUnit::Millimeter),
     linearDeflectionType (LinearDeflectionType::BoundingBoxRatio),
     linearDeflection (0.001),
-    angularDeflection (0.5)
+    angularDeflection (0.5),
+    triangleBudget (100000),
+    reuseTriangulation (false),
+    decimationRatio (1.0),
+    decimationMaxError (0.0),
+    computeNormals (true),
+    deduplicateSolids (false),
+    includeNodes (),
+    excludeNodes (),
+    skipHiddenShapes (false),
+    includeLayers (),
+    excludeLayers (),
+    meshReuse (nullptr),
+    tracer (nullptr)
 {
 
 }
 
+bool ImportParams::IsValid () const
+{
+    if (linearDeflectionType == LinearDeflectionType::TriangleBudget) {
+        return !reuseTriangulation && !deduplicateSolids && meshReuse == nullptr;
+    }
+    return true;
+}
+
 Importer::Importer ()
 {
 
@@ -74,8 +95,56 @@ Importer::Result Importer::LoadFile (const std::string& filePath, const ImportPa
         return Importer::Result::FileNotFound;
     }
 
-    std::vector<std::uint8_t> fileContent (std::istreambuf_iterator<char> (inputStream), {});
-    Importer::Result result = LoadFile (fileContent, params);
+    Importer::Result result = LoadStream (inputStream, params);
     inputStream.close ();
     return result;
 }
+
+Importer::Result Importer::LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params)
+{
+    VectorBuffer inputBuffer (fileContent);
+    std::istream inputStream (&inputBuffer);
+    return LoadStream (inputStream, params);
+}
+
+VectorBuffer::VectorBuffer (const std::vector<std::uint8_t>& v)
+{
+    setg ((char*) v.data (), (char*) v.data (), (char*) (v.data () + v.size ()));
+}
+
+ChunkBuffer::ChunkBuffer () :
+    chunks (),
+    nextChunk (0)
+{
+
+}
+
+void ChunkBuffer::AddChunk (std::vector<std::uint8_t>& chunk)
+{
+    // the chunk is moved, so the content is not copied again
+    chunks.push_back (std::vector<std::uint8_t> ());
+    chunks.back ().swap (chunk);
+}
+
+const std::vector<std::vector<std::uint8_t>>& ChunkBuffer::GetChunks () const
+{
+    return chunks;
+}
+
+ChunkBuffer::int_type ChunkBuffer::underflow ()
+{
+    while (nextChunk < chunks.size ()) {
+        // the chunk that is read already is not needed anymore
+        if (nextChunk > 0) {
+            std::vector<std::uint8_t> ().swap (chunks[nextChunk - 1]);
+        }
+        std::vector<std::uint8_t>& chunk = chunks[nextChunk];
+        nextChunk += 1;
+        if (!chunk.empty ()) {
+            char* begin = (char*) chunk.data ();
+            setg (begin, begin, begin + chunk.size ());
+            return traits_type::to_int_type (*gptr ());
+        }
+    }
+    return traits_type::eof ();
+}
@@ -4,12 +4,20 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <istream>
+#include <cstdint>
 
 class Node;
 class Importer;
+class MeshReuse;
+class Tracer;
 using NodePtr = std::shared_ptr<const Node>;
 using ImporterPtr = std::shared_ptr<Importer>;
 
+// writes the geometry of a face into preallocated buffers, normals can be null, otherwise
+// they are written for every vertex, even if the face has none, it doesn't refer to the face object, so it can be called later from any thread
+using FaceWriter = std::function<void (double* positions, double* normals, std::uint32_t* indices, std::uint32_t vertexOffset)>;
+
 class Color
 {
 public:
@@ -33,6 +41,10 @@ public:
     virtual void EnumerateVertices (const std::function<void (double, double, double)>& onVertex) const = 0;
     virtual void EnumerateNormals (const std::function<void (double, double, double)>& onNormal) const = 0;
     virtual void EnumerateTriangles (const std::function<void (int, int, int)>& onTriangle) const = 0;
+
+    virtual int GetVertexCount () const = 0;
+    virtual int GetTriangleCount () const = 0;
+    virtual FaceWriter GetWriter () const = 0;
 };
 
 class Mesh
@@ -42,6 +54,7 @@ public:
     virtual ~Mesh ();
 
     virtual std::string GetName () const = 0;
+    virtual std::string GetShapeKey () const = 0;
     virtual bool GetColor (Color& color) const = 0;
     virtual void EnumerateFaces (const std::function<void (const Face& face)>& onFace) const = 0;
 };
@@ -74,15 +87,41 @@ public:
     enum class LinearDeflectionType
     {
         BoundingBoxRatio,
-        AbsoluteValue
+        AbsoluteValue,
+        TriangleBudget
     };
 
     ImportParams ();
 
+    // the triangle budget mode meshes every part itself, so it can't be combined with
+    // the options that keep or copy existing triangulations
+    bool IsValid () const;
+
     LinearUnit linearUnit;
     LinearDeflectionType linearDeflectionType;
     double linearDeflection;
     double angularDeflection;
+    int triangleBudget;
+    bool reuseTriangulation;
+    double decimationRatio;
+    double decimationMaxError;
+    bool computeNormals;
+    bool deduplicateSolids;
+
+    // name, path or label entry patterns, excluded nodes are skipped with their whole subtree
+    std::vector<std::string> includeNodes;
+    std::vector<std::string> excludeNodes;
+
+    // hidden shapes and shapes on hidden layers, and layer name patterns
+    bool skipHiddenShapes;
+    std::vector<std::string> includeLayers;
+    std::vector<std::string> excludeLayers;
+
+    // meshes of a previous import, it is not part of the cache key, because it doesn't change the result
+    MeshReuse* meshReuse;
+
+    // collects trace events if it is not null, it is not part of the cache key either
+    Tracer* tracer;
 };
 
 class Importer
@@ -99,7 +138,32 @@ public:
     virtual ~Importer ();
 
     Result LoadFile (const std::string& filePath, const ImportParams& params);
+    Result LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params);
 
-    virtual Result LoadFile (const std::vector<std::uint8_t>& fileContent, const ImportParams& params) = 0;
+    virtual Result LoadStream (std::istream& inputStream, const ImportParams& params) = 0;
     virtual NodePtr GetRootNode () const = 0;
 };
+
+class VectorBuffer : public std::streambuf
+{
+public:
+    VectorBuffer (const std::vector<std::uint8_t>& v);
+};
+
+class ChunkBuffer : public std::streambuf
+{
+public:
+    ChunkBuffer ();
+
+    void AddChunk (std::vector<std::uint8_t>& chunk);
+
+    // the chunks that are already read are empty
+    const std::vector<std::vector<std::uint8_t>>& GetChunks () const;
+
+protected:
+    virtual int_type underflow () override;
+
+private:
+    std::vector<std::vector<std::uint8_t>> chunks;
+    size_t nextChunk;
+};
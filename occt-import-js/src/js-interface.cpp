@@ -1,32 +1,356 @@
 #ifdef EMSCRIPTEN
 
 #include "js-interface.hpp"
+
+// format-specific builds contain only one of the importers
+#if defined (OCCTIMPORTJS_STEP_ONLY)
+    #define OCCTIMPORTJS_WITH_STEP
+#elif defined (OCCTIMPORTJS_IGES_ONLY)
+    #define OCCTIMPORTJS_WITH_IGES
+#elif defined (OCCTIMPORTJS_BREP_ONLY)
+    #define OCCTIMPORTJS_WITH_BREP
+#else
+    #define OCCTIMPORTJS_WITH_STEP
+    #define OCCTIMPORTJS_WITH_IGES
+    #define OCCTIMPORTJS_WITH_BREP
+#endif
+
+#ifdef OCCTIMPORTJS_WITH_STEP
 #include "importer-step.hpp"
+#endif
+#ifdef OCCTIMPORTJS_WITH_IGES
 #include "importer-iges.hpp"
+#endif
+#ifdef OCCTIMPORTJS_WITH_BREP
 #include "importer-brep.hpp"
+#endif
+#include "importer-result.hpp"
+#include "importer-cache.hpp"
+#include "importer-reuse.hpp"
+#include "importer-batch.hpp"
+#include "importer-bvh.hpp"
+#include "importer-hierarchy.hpp"
+#include "importer-trace.hpp"
+#include "importer-utils.hpp"
 #include <emscripten/bind.h>
+#include <emscripten/heap.h>
+#include <malloc.h>
+
+#include <map>
+#include <functional>
+#include <tuple>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+
+static ImportParams GetImportParams (const emscripten::val& paramsVal)
+{
+    ImportParams params;
+    if (paramsVal.isUndefined () || paramsVal.isNull ()) {
+        return params;
+    }
+
+    if (paramsVal.hasOwnProperty ("linearUnit")) {
+        emscripten::val linearUnit = paramsVal["linearUnit"];
+        std::string linearUnitStr = linearUnit.as<std::string> ();
+        if (linearUnitStr == "millimeter") {
+            params.linearUnit = ImportParams::LinearUnit::Millimeter;
+        } else if (linearUnitStr == "centimeter") {
+            params.linearUnit = ImportParams::LinearUnit::Centimeter;
+        } else if (linearUnitStr == "meter") {
+            params.linearUnit = ImportParams::LinearUnit::Meter;
+        } else if (linearUnitStr == "inch") {
+            params.linearUnit = ImportParams::LinearUnit::Inch;
+        } else if (linearUnitStr == "foot") {
+            params.linearUnit = ImportParams::LinearUnit::Foot;
+        }
+    }
+
+    if (paramsVal.hasOwnProperty ("linearDeflectionType")) {
+        emscripten::val linearDeflectionType = paramsVal["linearDeflectionType"];
+        std::string linearDeflectionTypeStr = linearDeflectionType.as<std::string> ();
+        if (linearDeflectionTypeStr == "bounding_box_ratio") {
+            params.linearDeflectionType = ImportParams::LinearDeflectionType::BoundingBoxRatio;
+        } else if (linearDeflectionTypeStr == "absolute_value") {
+            params.linearDeflectionType = ImportParams::LinearDeflectionType::AbsoluteValue;
+        } else if (linearDeflectionTypeStr == "triangle_budget") {
+            params.linearDeflectionType = ImportParams::LinearDeflectionType::TriangleBudget;
+        }
+    }
+
+    if (paramsVal.hasOwnProperty ("linearDeflection")) {
+        emscripten::val linearDeflection = paramsVal["linearDeflection"];
+        params.linearDeflection = linearDeflection.as<double> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("angularDeflection")) {
+        emscripten::val angularDeflection = paramsVal["angularDeflection"];
+        params.angularDeflection = angularDeflection.as<double> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("triangleBudget")) {
+        emscripten::val triangleBudget = paramsVal["triangleBudget"];
+        params.triangleBudget = triangleBudget.as<int> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("reuseTriangulation")) {
+        emscripten::val reuseTriangulation = paramsVal["reuseTriangulation"];
+        params.reuseTriangulation = reuseTriangulation.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("decimationRatio")) {
+        emscripten::val decimationRatio = paramsVal["decimationRatio"];
+        params.decimationRatio = decimationRatio.as<double> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("decimationMaxError")) {
+        emscripten::val decimationMaxError = paramsVal["decimationMaxError"];
+        params.decimationMaxError = decimationMaxError.as<double> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("computeNormals")) {
+        emscripten::val computeNormals = paramsVal["computeNormals"];
+        params.computeNormals = computeNormals.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("deduplicateSolids")) {
+        emscripten::val deduplicateSolids = paramsVal["deduplicateSolids"];
+        params.deduplicateSolids = deduplicateSolids.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("includeNodes")) {
+        emscripten::val includeNodes = paramsVal["includeNodes"];
+        params.includeNodes = emscripten::vecFromJSArray<std::string> (includeNodes);
+    }
+
+    if (paramsVal.hasOwnProperty ("excludeNodes")) {
+        emscripten::val excludeNodes = paramsVal["excludeNodes"];
+        params.excludeNodes = emscripten::vecFromJSArray<std::string> (excludeNodes);
+    }
+
+    if (paramsVal.hasOwnProperty ("skipHiddenShapes")) {
+        emscripten::val skipHiddenShapes = paramsVal["skipHiddenShapes"];
+        params.skipHiddenShapes = skipHiddenShapes.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("includeLayers")) {
+        emscripten::val includeLayers = paramsVal["includeLayers"];
+        params.includeLayers = emscripten::vecFromJSArray<std::string> (includeLayers);
+    }
+
+    if (paramsVal.hasOwnProperty ("excludeLayers")) {
+        emscripten::val excludeLayers = paramsVal["excludeLayers"];
+        params.excludeLayers = emscripten::vecFromJSArray<std::string> (excludeLayers);
+    }
+
+    return params;
+}
+
+static emscripten::val CreateColorArray (const Color& color)
+{
+    emscripten::val colorArr (emscripten::val::array ());
+    colorArr.set (0, color.r);
+    colorArr.set (1, color.g);
+    colorArr.set (2, color.b);
+    return colorArr;
+}
+
+template <typename T>
+static emscripten::val CreateTypedArray (const char* arrayType, const std::vector<T>& data)
+{
+    // the view points into the wasm memory, so the data is copied into a new array
+    emscripten::val dataView (emscripten::typed_memory_view (data.size (), data.data ()));
+    return emscripten::val::global (arrayType).new_ (dataView);
+}
+
+class OutputParams
+{
+public:
+    OutputParams () :
+        compactBrepFaces (false),
+        mergeMeshes (false),
+        maxBatchVertices (1 << 20),
+        buildBvh (false),
+        sharedBuffer (false),
+        compactIndices (false),
+        flatHierarchy (false)
+    {
+    }
+
+    bool compactBrepFaces;
+    bool mergeMeshes;
+    int maxBatchVertices;
+    bool buildBvh;
+    bool sharedBuffer;
+    bool compactIndices;
+    bool flatHierarchy;
+};
+
+static OutputParams GetOutputParams (const emscripten::val& paramsVal)
+{
+    OutputParams params;
+    if (paramsVal.isUndefined () || paramsVal.isNull ()) {
+        return params;
+    }
+
+    if (paramsVal.hasOwnProperty ("compactBrepFaces")) {
+        emscripten::val compactBrepFaces = paramsVal["compactBrepFaces"];
+        params.compactBrepFaces = compactBrepFaces.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("mergeMeshes")) {
+        emscripten::val mergeMeshes = paramsVal["mergeMeshes"];
+        params.mergeMeshes = mergeMeshes.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("maxBatchVertices")) {
+        emscripten::val maxBatchVertices = paramsVal["maxBatchVertices"];
+        params.maxBatchVertices = maxBatchVertices.as<int> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("buildBvh")) {
+        emscripten::val buildBvh = paramsVal["buildBvh"];
+        params.buildBvh = buildBvh.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("sharedBuffer")) {
+        emscripten::val sharedBuffer = paramsVal["sharedBuffer"];
+        params.sharedBuffer = sharedBuffer.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("compactIndices")) {
+        emscripten::val compactIndices = paramsVal["compactIndices"];
+        params.compactIndices = compactIndices.as<bool> ();
+    }
+
+    if (paramsVal.hasOwnProperty ("flatHierarchy")) {
+        emscripten::val flatHierarchy = paramsVal["flatHierarchy"];
+        params.flatHierarchy = flatHierarchy.as<bool> ();
+    }
+
+    return params;
+}
+
+static const size_t MaxShortIndexVertices = 1 << 16;
+
+static bool UseShortIndices (const OutputParams& params, const std::vector<double>& positions)
+{
+    return params.compactIndices && positions.size () / 3 <= MaxShortIndexVertices;
+}
+
+class ColorPalette
+{
+public:
+    ColorPalette () :
+        mColors (),
+        mColorIndices ()
+    {
+    }
+
+    std::uint32_t AddColor (const Color& color)
+    {
+        std::tuple<double, double, double> key (color.r, color.g, color.b);
+        auto found = mColorIndices.find (key);
+        if (found != mColorIndices.end ()) {
+            return found->second;
+        }
+        std::uint32_t colorIndex = (std::uint32_t) (mColors.size () / 3);
+        mColors.push_back (color.r);
+        mColors.push_back (color.g);
+        mColors.push_back (color.b);
+        mColorIndices.insert ({ key, colorIndex });
+        return colorIndex;
+    }
+
+    const std::vector<double>& GetColors () const
+    {
+        return mColors;
+    }
+
+private:
+    std::vector<double> mColors;
+    std::map<std::tuple<double, double, double>, std::uint32_t> mColorIndices;
+};
+
+class SharedGeometryBuffer
+{
+public:
+    SharedGeometryBuffer () :
+        mBuffer (emscripten::val::null ()),
+        mByteLength (0),
+        mByteOffset (0)
+    {
+    }
+
+    template <typename T>
+    void Reserve (size_t count)
+    {
+        mByteLength += GetAlignedByteLength (count * sizeof (T));
+    }
+
+    void Allocate ()
+    {
+        mBuffer = emscripten::val::global ("SharedArrayBuffer").new_ (mByteLength);
+    }
+
+    template <typename T>
+    emscripten::val Write (const char* arrayType, const std::vector<T>& data)
+    {
+        static_assert (sizeof (T) == 2 || sizeof (T) == 4, "invalid element size");
+        emscripten::val targetArr = emscripten::val::global (arrayType).new_ (mBuffer, mByteOffset, data.size ());
+        targetArr.call<void> ("set", emscripten::val (emscripten::typed_memory_view (data.size (), data.data ())));
+
+        emscripten::val descriptorObj (emscripten::val::object ());
+        descriptorObj.set ("byteOffset", mByteOffset);
+        descriptorObj.set ("length", data.size ());
+        mByteOffset += GetAlignedByteLength (data.size () * sizeof (T));
+        return descriptorObj;
+    }
+
+    const emscripten::val& GetBuffer () const
+    {
+        return mBuffer;
+    }
+
+private:
+    static size_t GetAlignedByteLength (size_t byteLength)
+    {
+        // every array starts at a four byte boundary, so two byte arrays are padded
+        return (byteLength + 3) & ~((size_t) 3);
+    }
+
+    emscripten::val mBuffer;
+    size_t mByteLength;
+    size_t mByteOffset;
+};
 
 class HierarchyWriter
 {
 public:
-    HierarchyWriter (emscripten::val& meshesArr) :
+    HierarchyWriter (const ImportResult& result, const OutputParams& params, emscripten::val& meshesArr) :
+        mResult (result),
+        mParams (params),
         mMeshesArr (meshesArr),
-        mMeshCount (0)
+        mPalette (),
+        mShortColorIndices (false),
+        mBatches (),
+        mSharedBuffer ()
     {
     }
 
-    void WriteNode (const NodePtr& node, emscripten::val& nodeObj)
+    void WriteNode (const ResultNode& node, emscripten::val& nodeObj)
     {
-        nodeObj.set ("name", node->GetName ());
+        nodeObj.set ("name", node.name);
 
         emscripten::val nodeMeshesArr (emscripten::val::array ());
-        WriteMeshes (node, nodeMeshesArr);
+        for (int nodeMeshIndex = 0; nodeMeshIndex < node.meshes.size (); nodeMeshIndex++) {
+            nodeMeshesArr.set (nodeMeshIndex, node.meshes[nodeMeshIndex]);
+        }
         nodeObj.set ("meshes", nodeMeshesArr);
 
-        std::vector<NodePtr> children = node->GetChildren ();
         emscripten::val childrenArr (emscripten::val::array ());
-        for (int childIndex = 0; childIndex < children.size (); childIndex++) {
-            const NodePtr& child = children[childIndex];
+        for (int childIndex = 0; childIndex < node.children.size (); childIndex++) {
+            const ResultNode& child = node.children[childIndex];
             emscripten::val childNodeObj (emscripten::val::object ());
             WriteNode (child, childNodeObj);
             childrenArr.set (childIndex, childNodeObj);
@@ -34,230 +358,648 @@ public:
         nodeObj.set ("children", childrenArr);
     }
 
-private:
-    void WriteMeshes (const NodePtr& node, emscripten::val& nodeMeshesArr)
+    void WriteFlatHierarchy (emscripten::val& nodesObj)
+    {
+        ResultFlatHierarchy hierarchy;
+        FlattenHierarchy (mResult.root, hierarchy);
+        nodesObj.set ("parents", CreateTypedArray ("Int32Array", hierarchy.parents));
+        nodesObj.set ("firstChildren", CreateTypedArray ("Int32Array", hierarchy.firstChildren));
+        nodesObj.set ("nextSiblings", CreateTypedArray ("Int32Array", hierarchy.nextSiblings));
+        nodesObj.set ("nameOffsets", CreateTypedArray ("Uint32Array", hierarchy.nameOffsets));
+        nodesObj.set ("names", CreateTypedArray ("Uint8Array", hierarchy.names));
+        nodesObj.set ("meshOffsets", CreateTypedArray ("Uint32Array", hierarchy.meshOffsets));
+        nodesObj.set ("meshes", CreateTypedArray ("Uint32Array", hierarchy.meshes));
+    }
+
+    void WriteMeshes ()
     {
-        if (!node->IsMeshNode ()) {
-            return;
+        std::vector<emscripten::val> meshBatchObjs (mResult.meshes.size (), emscripten::val::null ());
+        if (mParams.mergeMeshes) {
+            // with compact indices the batches are small enough for 16-bit indices
+            size_t maxBatchVertices = mParams.maxBatchVertices;
+            if (mParams.compactIndices) {
+                maxBatchVertices = std::min (maxBatchVertices, MaxShortIndexVertices);
+            }
+            BatchMeshes (mResult, maxBatchVertices, mBatches);
+            for (int batchIndex = 0; batchIndex < mBatches.size (); batchIndex++) {
+                for (const ResultBatchRange& range : mBatches[batchIndex].ranges) {
+                    emscripten::val meshBatchObj (emscripten::val::object ());
+                    meshBatchObj.set ("index", batchIndex);
+                    meshBatchObj.set ("first", range.firstTriangle);
+                    meshBatchObjs[range.mesh] = meshBatchObj;
+                }
+            }
+        }
+
+        if (mParams.sharedBuffer) {
+            AllocateSharedBuffer ();
+        }
+
+        if (mParams.compactBrepFaces) {
+            BuildPalette ();
         }
 
-        int nodeMeshCount = 0;
-        node->EnumerateMeshes ([&](const Mesh& mesh) {
+        for (int meshIndex = 0; meshIndex < mResult.meshes.size (); meshIndex++) {
+            const ResultMesh& mesh = mResult.meshes[meshIndex];
             emscripten::val meshObj (emscripten::val::object ());
-            meshObj.set ("name", mesh.GetName ());
-
-            int vertexCount = 0;
-            int normalCount = 0;
-            int triangleCount = 0;
-            int brepFaceCount = 0;
-
-            emscripten::val positionArr (emscripten::val::array ());
-            emscripten::val normalArr (emscripten::val::array ());
-            emscripten::val indexArr (emscripten::val::array ());
-            emscripten::val brepFaceArr (emscripten::val::array ());
-
-            mesh.EnumerateFaces ([&](const Face& face) {
-                int triangleOffset = triangleCount;
-                int vertexOffset = vertexCount;
-                face.EnumerateVertices ([&](double x, double y, double z) {
-                    positionArr.set (vertexCount * 3, x);
-                    positionArr.set (vertexCount * 3 + 1, y);
-                    positionArr.set (vertexCount * 3 + 2, z);
-                    vertexCount += 1;
-                });
-                face.EnumerateNormals ([&](double x, double y, double z) {
-                    normalArr.set (normalCount * 3, x);
-                    normalArr.set (normalCount * 3 + 1, y);
-                    normalArr.set (normalCount * 3 + 2, z);
-                    normalCount += 1;
-                });
-                face.EnumerateTriangles ([&](int v0, int v1, int v2) {
-                    indexArr.set (triangleCount * 3, vertexOffset + v0);
-                    indexArr.set (triangleCount * 3 + 1, vertexOffset + v1);
-                    indexArr.set (triangleCount * 3 + 2, vertexOffset + v2);
-                    triangleCount += 1;
-                });
-                emscripten::val brepFaceObj (emscripten::val::object ());
-                brepFaceObj.set ("first", triangleOffset);
-                brepFaceObj.set ("last", triangleCount - 1);
-                Color faceColor;
-                if (face.GetColor (faceColor)) {
-                    emscripten::val colorArr (emscripten::val::array ());
-                    colorArr.set (0, faceColor.r);
-                    colorArr.set (1, faceColor.g);
-                    colorArr.set (2, faceColor.b);
-                    brepFaceObj.set ("color", colorArr);
-                } else {
-                    brepFaceObj.set ("color", emscripten::val::null ());
+            meshObj.set ("name", mesh.name);
+
+            if (mParams.mergeMeshes) {
+                meshObj.set ("batch", meshBatchObjs[meshIndex]);
+            } else {
+                WriteMeshGeometry (mesh, meshObj);
+            }
+
+            if (mesh.hasColor) {
+                meshObj.set ("color", CreateColorArray (mesh.color));
+            }
+
+            if (mParams.compactBrepFaces) {
+                meshObj.set ("brep_faces", CreateCompactBrepFaces (mesh));
+            } else {
+                meshObj.set ("brep_faces", CreateBrepFaces (mesh));
+            }
+
+            mMeshesArr.set (meshIndex, meshObj);
+        }
+    }
+
+    void WriteBatches (emscripten::val& batchesArr)
+    {
+        for (int batchIndex = 0; batchIndex < mBatches.size (); batchIndex++) {
+            const ResultBatch& batch = mBatches[batchIndex];
+            emscripten::val batchObj (emscripten::val::object ());
+
+            if (mParams.sharedBuffer) {
+                WriteSharedGeometry (batch.positions, batch.normals, batch.indices, batchObj);
+            } else {
+                emscripten::val attributesObj (emscripten::val::object ());
+
+                emscripten::val positionObj (emscripten::val::object ());
+                positionObj.set ("array", CreateTypedArray ("Float32Array", std::vector<float> (batch.positions.begin (), batch.positions.end ())));
+                attributesObj.set ("position", positionObj);
+
+                if (batch.positions.size () == batch.normals.size ()) {
+                    emscripten::val normalObj (emscripten::val::object ());
+                    normalObj.set ("array", CreateTypedArray ("Float32Array", std::vector<float> (batch.normals.begin (), batch.normals.end ())));
+                    attributesObj.set ("normal", normalObj);
                 }
-                brepFaceArr.set (brepFaceCount, brepFaceObj);
-                brepFaceCount += 1;
-            });
 
-            emscripten::val attributesObj (emscripten::val::object ());
+                emscripten::val indexObj (emscripten::val::object ());
+                indexObj.set ("array", CreateIndexArray (batch.positions, batch.indices));
 
-            emscripten::val positionObj (emscripten::val::object ());
-            positionObj.set ("array", positionArr);
-            attributesObj.set ("position", positionObj);
+                batchObj.set ("attributes", attributesObj);
+                batchObj.set ("index", indexObj);
+            }
 
-            if (vertexCount == normalCount) {
-                emscripten::val normalObj (emscripten::val::object ());
-                normalObj.set ("array", normalArr);
-                attributesObj.set ("normal", normalObj);
+            if (batch.hasColor) {
+                batchObj.set ("color", CreateColorArray (batch.color));
             }
 
-            emscripten::val indexObj (emscripten::val::object ());
-            indexObj.set ("array", indexArr);
+            // mesh index, first triangle and triangle count for every merged mesh
+            std::vector<std::uint32_t> ranges;
+            ranges.reserve (batch.ranges.size () * 3);
+            for (const ResultBatchRange& range : batch.ranges) {
+                ranges.push_back (range.mesh);
+                ranges.push_back (range.firstTriangle);
+                ranges.push_back (range.triangleCount);
+            }
+            batchObj.set ("ranges", CreateTypedArray ("Uint32Array", ranges));
+
+            if (mParams.buildBvh) {
+                batchObj.set ("bvh", CreateBvh (batch.positions, batch.indices));
+            }
+
+            batchesArr.set (batchIndex, batchObj);
+        }
+    }
 
-            meshObj.set ("attributes", attributesObj);
+    emscripten::val GetPaletteColors () const
+    {
+        return CreateTypedArray ("Float64Array", mPalette.GetColors ());
+    }
+
+    const emscripten::val& GetSharedBuffer () const
+    {
+        return mSharedBuffer.GetBuffer ();
+    }
+
+private:
+    void BuildPalette ()
+    {
+        // the type of the color indices depends on the size of the whole palette,
+        // so it is built before any of the meshes is written
+        for (const ResultMesh& mesh : mResult.meshes) {
+            for (const ResultBrepFace& brepFace : mesh.brepFaces) {
+                if (brepFace.hasColor) {
+                    mPalette.AddColor (brepFace.color);
+                }
+            }
+        }
+        mShortColorIndices = (mPalette.GetColors ().size () / 3 < UINT16_MAX);
+    }
+
+    void AllocateSharedBuffer ()
+    {
+        // the arrays must be written in the same order as they are reserved here
+        auto reserveGeometry = [&] (const std::vector<double>& positions, const std::vector<double>& normals, const std::vector<std::uint32_t>& indices) {
+            mSharedBuffer.Reserve<float> (positions.size ());
+            if (positions.size () == normals.size ()) {
+                mSharedBuffer.Reserve<float> (normals.size ());
+            }
+            if (UseShortIndices (mParams, positions)) {
+                mSharedBuffer.Reserve<std::uint16_t> (indices.size ());
+            } else {
+                mSharedBuffer.Reserve<std::uint32_t> (indices.size ());
+            }
+        };
+        if (mParams.mergeMeshes) {
+            for (const ResultBatch& batch : mBatches) {
+                reserveGeometry (batch.positions, batch.normals, batch.indices);
+            }
+        } else {
+            for (const ResultMesh& mesh : mResult.meshes) {
+                reserveGeometry (mesh.positions, mesh.normals, mesh.indices);
+            }
+        }
+        mSharedBuffer.Allocate ();
+    }
+
+    void WriteSharedGeometry (const std::vector<double>& positions, const std::vector<double>& normals, const std::vector<std::uint32_t>& indices, emscripten::val& meshObj)
+    {
+        emscripten::val attributesObj (emscripten::val::object ());
+        attributesObj.set ("position", mSharedBuffer.Write ("Float32Array", std::vector<float> (positions.begin (), positions.end ())));
+        if (positions.size () == normals.size ()) {
+            attributesObj.set ("normal", mSharedBuffer.Write ("Float32Array", std::vector<float> (normals.begin (), normals.end ())));
+        }
+        meshObj.set ("attributes", attributesObj);
+        if (UseShortIndices (mParams, positions)) {
+            emscripten::val indexObj = mSharedBuffer.Write ("Uint16Array", std::vector<std::uint16_t> (indices.begin (), indices.end ()));
+            indexObj.set ("type", std::string ("Uint16Array"));
             meshObj.set ("index", indexObj);
+        } else {
+            emscripten::val indexObj = mSharedBuffer.Write ("Uint32Array", indices);
+            if (mParams.compactIndices) {
+                indexObj.set ("type", std::string ("Uint32Array"));
+            }
+            meshObj.set ("index", indexObj);
+        }
+    }
 
-            Color meshColor;
-            if (mesh.GetColor (meshColor)) {
-                emscripten::val colorArr (emscripten::val::array ());
-                colorArr.set (0, meshColor.r);
-                colorArr.set (1, meshColor.g);
-                colorArr.set (2, meshColor.b);
-                meshObj.set ("color", colorArr);
+    void WriteMeshGeometry (const ResultMesh& mesh, emscripten::val& meshObj)
+    {
+        if (mParams.sharedBuffer) {
+            WriteSharedGeometry (mesh.positions, mesh.normals, mesh.indices, meshObj);
+        } else {
+            WriteArrayGeometry (mesh, meshObj);
+        }
+
+        if (mParams.buildBvh) {
+            meshObj.set ("bvh", CreateBvh (mesh.positions, mesh.indices));
+        }
+    }
+
+    void WriteArrayGeometry (const ResultMesh& mesh, emscripten::val& meshObj)
+    {
+        emscripten::val positionArr (emscripten::val::array ());
+        for (int i = 0; i < mesh.positions.size (); i++) {
+            positionArr.set (i, mesh.positions[i]);
+        }
+
+        emscripten::val normalArr (emscripten::val::array ());
+        for (int i = 0; i < mesh.normals.size (); i++) {
+            normalArr.set (i, mesh.normals[i]);
+        }
+
+        emscripten::val indexArr (emscripten::val::array ());
+        if (mParams.compactIndices) {
+            indexArr = CreateIndexArray (mesh.positions, mesh.indices);
+        } else {
+            for (int i = 0; i < mesh.indices.size (); i++) {
+                indexArr.set (i, mesh.indices[i]);
             }
+        }
+
+        emscripten::val attributesObj (emscripten::val::object ());
 
-            meshObj.set ("brep_faces", brepFaceArr);
+        emscripten::val positionObj (emscripten::val::object ());
+        positionObj.set ("array", positionArr);
+        attributesObj.set ("position", positionObj);
 
-            mMeshesArr.set (mMeshCount, meshObj);
-            nodeMeshesArr.set (nodeMeshCount, mMeshCount);
-            mMeshCount += 1;
-            nodeMeshCount += 1;
-        });
+        if (mesh.positions.size () == mesh.normals.size ()) {
+            emscripten::val normalObj (emscripten::val::object ());
+            normalObj.set ("array", normalArr);
+            attributesObj.set ("normal", normalObj);
+        }
+
+        emscripten::val indexObj (emscripten::val::object ());
+        indexObj.set ("array", indexArr);
+
+        meshObj.set ("attributes", attributesObj);
+        meshObj.set ("index", indexObj);
+    }
+
+    emscripten::val CreateIndexArray (const std::vector<double>& positions, const std::vector<std::uint32_t>& indices) const
+    {
+        if (UseShortIndices (mParams, positions)) {
+            return CreateTypedArray ("Uint16Array", std::vector<std::uint16_t> (indices.begin (), indices.end ()));
+        }
+        return CreateTypedArray ("Uint32Array", indices);
     }
 
+    emscripten::val CreateBvh (const std::vector<double>& positions, const std::vector<std::uint32_t>& indices)
+    {
+        ResultBvh bvh;
+        BuildBvh (positions, indices, bvh);
+
+        emscripten::val bvhObj (emscripten::val::object ());
+        bvhObj.set ("bounds", CreateTypedArray ("Float32Array", bvh.bounds));
+        bvhObj.set ("nodes", CreateTypedArray ("Int32Array", bvh.nodes));
+        bvhObj.set ("triangles", CreateTypedArray ("Uint32Array", bvh.triangles));
+        return bvhObj;
+    }
+
+    emscripten::val CreateBrepFaces (const ResultMesh& mesh)
+    {
+        emscripten::val brepFaceArr (emscripten::val::array ());
+        for (int brepFaceIndex = 0; brepFaceIndex < mesh.brepFaces.size (); brepFaceIndex++) {
+            const ResultBrepFace& brepFace = mesh.brepFaces[brepFaceIndex];
+            emscripten::val brepFaceObj (emscripten::val::object ());
+            brepFaceObj.set ("first", brepFace.first);
+            brepFaceObj.set ("last", brepFace.last);
+            if (brepFace.hasColor) {
+                brepFaceObj.set ("color", CreateColorArray (brepFace.color));
+            } else {
+                brepFaceObj.set ("color", emscripten::val::null ());
+            }
+            brepFaceArr.set (brepFaceIndex, brepFaceObj);
+        }
+        return brepFaceArr;
+    }
+
+    emscripten::val CreateCompactBrepFaces (const ResultMesh& mesh)
+    {
+        // face i contains the triangles from offsets[i] to offsets[i + 1], and the color is an index
+        // into the palette of the result, the maximal value of the array type means no color
+        std::vector<std::uint32_t> offsets;
+        std::vector<std::uint32_t> colors;
+        offsets.reserve (mesh.brepFaces.size () + 1);
+        colors.reserve (mesh.brepFaces.size ());
+        offsets.push_back (0);
+        for (const ResultBrepFace& brepFace : mesh.brepFaces) {
+            offsets.push_back (brepFace.last + 1);
+            colors.push_back (brepFace.hasColor ? mPalette.AddColor (brepFace.color) : UINT32_MAX);
+        }
+
+        emscripten::val brepFacesObj (emscripten::val::object ());
+        brepFacesObj.set ("offsets", CreateTypedArray ("Uint32Array", offsets));
+        if (mShortColorIndices) {
+            std::vector<std::uint16_t> shortColors (colors.size ());
+            for (size_t i = 0; i < colors.size (); i++) {
+                shortColors[i] = (colors[i] == UINT32_MAX ? UINT16_MAX : (std::uint16_t) colors[i]);
+            }
+            brepFacesObj.set ("colors", CreateTypedArray ("Uint16Array", shortColors));
+        } else {
+            brepFacesObj.set ("colors", CreateTypedArray ("Uint32Array", colors));
+        }
+        return brepFacesObj;
+    }
+
+    const ImportResult& mResult;
+    const OutputParams& mParams;
     emscripten::val& mMeshesArr;
-    int mMeshCount;
+    ColorPalette mPalette;
+    bool mShortColorIndices;
+    std::vector<ResultBatch> mBatches;
+    SharedGeometryBuffer mSharedBuffer;
 };
 
-static void EnumerateNodeMeshes (const NodePtr& node, const std::function<void (const Mesh&)>& onMesh)
+static bool HasParam (const emscripten::val& paramsVal, const char* paramName)
 {
-    if (node->IsMeshNode ()) {
-        node->EnumerateMeshes (onMesh);
+    if (paramsVal.isUndefined () || paramsVal.isNull () || !paramsVal.hasOwnProperty (paramName)) {
+        return false;
     }
-    std::vector<NodePtr> children = node->GetChildren ();
-    for (const NodePtr& child : children) {
-        EnumerateNodeMeshes (child, onMesh);
+    emscripten::val paramVal = paramsVal[paramName];
+    return !paramVal.isUndefined () && !paramVal.isNull ();
+}
+
+static bool GetCachedResult (const emscripten::val& paramsVal, const std::string& cacheKey, ImportResult& result)
+{
+    if (!HasParam (paramsVal, "cacheData")) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> cacheDataArr = emscripten::convertJSArrayToNumberVector<std::uint8_t> (paramsVal["cacheData"]);
+    std::string storedCacheKey;
+    if (!DeserializeResult (cacheDataArr, storedCacheKey, result)) {
+        return false;
     }
+    return storedCacheKey == cacheKey;
 }
 
-static emscripten::val ImportFile (ImporterPtr importer, const emscripten::val& buffer, const ImportParams& params)
+static bool IsCacheOutputRequested (const emscripten::val& paramsVal)
 {
-    emscripten::val resultObj (emscripten::val::object ());
+    return HasParam (paramsVal, "cacheOutput") && paramsVal["cacheOutput"].as<bool> ();
+}
+
+static bool IsReuseOutputRequested (const emscripten::val& paramsVal)
+{
+    return IsCacheOutputRequested (paramsVal) && HasParam (paramsVal, "reuseOutput") && paramsVal["reuseOutput"].as<bool> ();
+}
+
+static bool IsTraceRequested (const emscripten::val& paramsVal)
+{
+    return HasParam (paramsVal, "trace") && paramsVal["trace"].as<bool> ();
+}
 
-    const std::vector<uint8_t>& bufferArr = emscripten::vecFromJSArray<std::uint8_t> (buffer);
-    Importer::Result importResult = importer->LoadFile (bufferArr, params);
-    resultObj.set ("success", importResult == Importer::Result::Success);
-    if (importResult != Importer::Result::Success) {
-        return resultObj;
+static void AddPreviousResult (const emscripten::val& paramsVal, MeshReuse& meshReuse)
+{
+    if (!HasParam (paramsVal, "previousData")) {
+        return;
+    }
+
+    // the cache data of any previous import can be used, the key doesn't have to match
+    std::vector<std::uint8_t> previousDataArr = emscripten::convertJSArrayToNumberVector<std::uint8_t> (paramsVal["previousData"]);
+    std::string previousCacheKey;
+    ImportResult previousResult;
+    if (DeserializeResult (previousDataArr, previousCacheKey, previousResult)) {
+        meshReuse.AddPreviousResult (previousResult);
     }
+}
 
-    int meshIndex = 0;
-    emscripten::val rootNodeObj (emscripten::val::object ());
+static void WriteResult (const ImportResult& importResult, const OutputParams& outputParams, Tracer* tracer, emscripten::val& resultObj)
+{
+    TraceScope writeScope (tracer, "WriteResult");
     emscripten::val meshesArr (emscripten::val::array ());
-    NodePtr rootNode = importer->GetRootNode ();
 
-    HierarchyWriter hierarchyWriter (meshesArr);
-    hierarchyWriter.WriteNode (rootNode, rootNodeObj);
+    HierarchyWriter hierarchyWriter (importResult, outputParams, meshesArr);
+    {
+        TraceScope hierarchyScope (tracer, "WriteHierarchy");
+        if (outputParams.flatHierarchy) {
+            emscripten::val nodesObj (emscripten::val::object ());
+            hierarchyWriter.WriteFlatHierarchy (nodesObj);
+            resultObj.set ("nodes", nodesObj);
+        } else {
+            emscripten::val rootNodeObj (emscripten::val::object ());
+            hierarchyWriter.WriteNode (importResult.root, rootNodeObj);
+            resultObj.set ("root", rootNodeObj);
+        }
+    }
+    {
+        TraceScope meshesScope (tracer, "WriteMeshes");
+        meshesScope.AddArg ("meshes", (int) importResult.meshes.size ());
+        hierarchyWriter.WriteMeshes ();
+    }
 
-    resultObj.set ("root", rootNodeObj);
     resultObj.set ("meshes", meshesArr);
-    return resultObj;
+    if (outputParams.compactBrepFaces) {
+        resultObj.set ("colors", hierarchyWriter.GetPaletteColors ());
+    }
+    if (outputParams.mergeMeshes) {
+        TraceScope batchesScope (tracer, "WriteBatches");
+        emscripten::val batchesArr (emscripten::val::array ());
+        hierarchyWriter.WriteBatches (batchesArr);
+        resultObj.set ("batches", batchesArr);
+    }
+    if (outputParams.sharedBuffer) {
+        resultObj.set ("sharedBuffer", hierarchyWriter.GetSharedBuffer ());
+    }
 }
 
-static ImportParams GetImportParams (const emscripten::val& paramsVal)
+static void WriteTrace (const Tracer* tracer, emscripten::val& resultObj)
 {
-    ImportParams params;
-    if (paramsVal.isUndefined () || paramsVal.isNull ()) {
-        return params;
+    if (tracer != nullptr) {
+        resultObj.set ("trace", tracer->GetJson ());
     }
+}
 
-    if (paramsVal.hasOwnProperty ("linearUnit")) {
-        emscripten::val linearUnit = paramsVal["linearUnit"];
-        std::string linearUnitStr = linearUnit.as<std::string> ();
-        if (linearUnitStr == "millimeter") {
-            params.linearUnit = ImportParams::LinearUnit::Millimeter;
-        } else if (linearUnitStr == "centimeter") {
-            params.linearUnit = ImportParams::LinearUnit::Centimeter;
-        } else if (linearUnitStr == "meter") {
-            params.linearUnit = ImportParams::LinearUnit::Meter;
-        } else if (linearUnitStr == "inch") {
-            params.linearUnit = ImportParams::LinearUnit::Inch;
-        } else if (linearUnitStr == "foot") {
-            params.linearUnit = ImportParams::LinearUnit::Foot;
-        }
+// the content can be a buffer or a chunked stream, so only these two steps depend on it
+using CacheKeyGetter = std::function<std::string (const ImportParams& params)>;
+using ContentLoader = std::function<Importer::Result (Importer& importer, const ImportParams& params)>;
+
+static emscripten::val ImportContent (ImporterPtr&& importer, const std::string& format, const CacheKeyGetter& getCacheKey, const ContentLoader& loadContent, const emscripten::val& paramsVal)
+{
+    emscripten::val resultObj (emscripten::val::object ());
+
+    ImportParams params = GetImportParams (paramsVal);
+    OutputParams outputParams = GetOutputParams (paramsVal);
+
+    bool useCache = IsCacheOutputRequested (paramsVal) || HasParam (paramsVal, "cacheData");
+    std::string cacheKey = useCache ? getCacheKey (params) : std::string ();
+
+    // the keys of the meshes are needed only if the result will be used by a later import, or it uses an earlier one
+    MeshReuse meshReuse;
+    bool reuseMeshes = IsReuseOutputRequested (paramsVal) || HasParam (paramsVal, "previousData");
+    if (reuseMeshes) {
+        AddPreviousResult (paramsVal, meshReuse);
+        params.meshReuse = &meshReuse;
     }
 
-    if (paramsVal.hasOwnProperty ("linearDeflectionType")) {
-        emscripten::val linearDeflectionType = paramsVal["linearDeflectionType"];
-        std::string linearDeflectionTypeStr = linearDeflectionType.as<std::string> ();
-        if (linearDeflectionTypeStr == "bounding_box_ratio") {
-            params.linearDeflectionType = ImportParams::LinearDeflectionType::BoundingBoxRatio;
-        } else if (linearDeflectionTypeStr == "absolute_value") {
-            params.linearDeflectionType = ImportParams::LinearDeflectionType::AbsoluteValue;
+    Tracer tracer;
+    if (IsTraceRequested (paramsVal)) {
+        params.tracer = &tracer;
+    }
+
+    ImportResult importResult;
+    bool isCacheHit = useCache && GetCachedResult (paramsVal, cacheKey, importResult);
+    if (!isCacheHit) {
+        Importer::Result loadResult = Importer::Result::ImportFailed;
+        {
+            TraceScope importScope (params.tracer, "Import");
+            importScope.AddArg ("format", format);
+            loadResult = loadContent (*importer, params);
+            if (loadResult == Importer::Result::Success) {
+                ExtractResult (importer->GetRootNode (), params, importResult);
+            }
+            // the result is extracted, so the memory of the import is released before writing the output
+            // (the callers move the importer here, so this is the only reference to it)
+            meshReuse.ReleaseShapes ();
+            ReleaseImporter (importer);
+        }
+        resultObj.set ("success", loadResult == Importer::Result::Success);
+        if (loadResult != Importer::Result::Success) {
+            WriteTrace (params.tracer, resultObj);
+            return resultObj;
         }
+    } else {
+        resultObj.set ("success", true);
     }
 
-    if (paramsVal.hasOwnProperty ("linearDeflection")) {
-        emscripten::val linearDeflection = paramsVal["linearDeflection"];
-        params.linearDeflection = linearDeflection.as<double> ();
+    WriteResult (importResult, outputParams, params.tracer, resultObj);
+    if (HasParam (paramsVal, "previousData")) {
+        resultObj.set ("reusedMeshes", meshReuse.GetReusedMeshCount ());
     }
 
-    if (paramsVal.hasOwnProperty ("angularDeflection")) {
-        emscripten::val angularDeflection = paramsVal["angularDeflection"];
-        params.angularDeflection = angularDeflection.as<double> ();
+    if (IsCacheOutputRequested (paramsVal)) {
+        resultObj.set ("cacheKey", cacheKey);
+        resultObj.set ("cacheHit", isCacheHit);
+        if (!isCacheHit) {
+            std::vector<std::uint8_t> cacheData;
+            SerializeResult (importResult, cacheKey, cacheData);
+            resultObj.set ("cacheData", CreateTypedArray ("Uint8Array", cacheData));
+        }
     }
 
-    return params;
+    WriteTrace (params.tracer, resultObj);
+    return resultObj;
+}
+
+static emscripten::val ImportFile (ImporterPtr&& importer, const std::string& format, const emscripten::val& buffer, const emscripten::val& paramsVal)
+{
+    const std::vector<uint8_t>& bufferArr = emscripten::convertJSArrayToNumberVector<std::uint8_t> (buffer);
+    return ImportContent (std::move (importer), format, [&] (const ImportParams& params) {
+        return GetCacheKey (format, bufferArr, params);
+    }, [&] (Importer& contentImporter, const ImportParams& params) {
+        return contentImporter.LoadFile (bufferArr, params);
+    }, paramsVal);
 }
 
+#ifdef OCCTIMPORTJS_WITH_STEP
 emscripten::val ReadStepFile (const emscripten::val& buffer, const emscripten::val& params)
 {
-    ImporterPtr importer = std::make_shared<ImporterStep> ();
-    ImportParams importParams = GetImportParams (params);
-    return ImportFile (importer, buffer, importParams);
+    return ImportFile (std::make_shared<ImporterStep> (), "step", buffer, params);
 }
+#endif
 
+#ifdef OCCTIMPORTJS_WITH_IGES
 emscripten::val ReadIgesFile (const emscripten::val& buffer, const emscripten::val& params)
 {
-    ImporterPtr importer = std::make_shared<ImporterIges> ();
-    ImportParams importParams = GetImportParams (params);
-    return ImportFile (importer, buffer, importParams);
+    return ImportFile (std::make_shared<ImporterIges> (), "iges", buffer, params);
 }
+#endif
 
+#ifdef OCCTIMPORTJS_WITH_BREP
 emscripten::val ReadBrepFile (const emscripten::val& buffer, const emscripten::val& params)
 {
-    ImporterPtr importer = std::make_shared<ImporterBrep> ();
-    ImportParams importParams = GetImportParams (params);
-    return ImportFile (importer, buffer, importParams);
+    return ImportFile (std::make_shared<ImporterBrep> (), "brep", buffer, params);
 }
+#endif
 
 emscripten::val ReadFile (const std::string& format, const emscripten::val& buffer, const emscripten::val& params)
 {
+#ifdef OCCTIMPORTJS_WITH_STEP
     if (format == "step") {
         return ReadStepFile (buffer, params);
-    } else if (format == "iges") {
+    }
+#endif
+#ifdef OCCTIMPORTJS_WITH_IGES
+    if (format == "iges") {
         return ReadIgesFile (buffer, params);
-    } else if (format == "brep") {
+    }
+#endif
+#ifdef OCCTIMPORTJS_WITH_BREP
+    if (format == "brep") {
         return ReadBrepFile (buffer, params);
-    } else {
+    }
+#endif
+    emscripten::val resultObj (emscripten::val::object ());
+    resultObj.set ("success", false);
+    return resultObj;
+}
+
+static ImporterPtr CreateImporter (const std::string& format)
+{
+#ifdef OCCTIMPORTJS_WITH_STEP
+    if (format == "step") {
+        return std::make_shared<ImporterStep> ();
+    }
+#endif
+#ifdef OCCTIMPORTJS_WITH_IGES
+    if (format == "iges") {
+        return std::make_shared<ImporterIges> ();
+    }
+#endif
+#ifdef OCCTIMPORTJS_WITH_BREP
+    if (format == "brep") {
+        return std::make_shared<ImporterBrep> ();
+    }
+#endif
+    return nullptr;
+}
+
+class ChunkedReader
+{
+public:
+    ChunkedReader (const std::string& format) :
+        mFormat (format),
+        mBuffer (),
+        mFinished (false)
+    {
+    }
+
+    void PushChunk (const emscripten::val& chunk)
+    {
+        // every chunk is copied into the wasm memory only once, so the caller can release it
+        std::vector<std::uint8_t> chunkArr = emscripten::convertJSArrayToNumberVector<std::uint8_t> (chunk);
+        mBuffer.AddChunk (chunkArr);
+    }
+
+    emscripten::val Finish (const emscripten::val& paramsVal)
+    {
         emscripten::val resultObj (emscripten::val::object ());
-        resultObj.set ("success", false);
-        return resultObj;
+        ImporterPtr importer = CreateImporter (mFormat);
+        if (mFinished || importer == nullptr) {
+            resultObj.set ("success", false);
+            return resultObj;
+        }
+        mFinished = true;
+
+        // the cache key is calculated before the import, because the chunks are released while they are read
+        return ImportContent (std::move (importer), mFormat, [&] (const ImportParams& params) {
+            return GetCacheKey (mFormat, mBuffer.GetChunks (), params);
+        }, [&] (Importer& contentImporter, const ImportParams& params) {
+            std::istream inputStream (&mBuffer);
+            return contentImporter.LoadStream (inputStream, params);
+        }, paramsVal);
     }
+
+private:
+    std::string mFormat;
+    ChunkBuffer mBuffer;
+    bool mFinished;
+};
+
+std::string GetFileCacheKey (const std::string& format, const emscripten::val& buffer, const emscripten::val& params)
+{
+    ImportParams importParams = GetImportParams (params);
+    std::vector<std::uint8_t> bufferArr = emscripten::convertJSArrayToNumberVector<std::uint8_t> (buffer);
+    return GetCacheKey (format, bufferArr, importParams);
+}
+
+emscripten::val GetMemoryInfo ()
+{
+    // the heap never shrinks, but it grows in large steps, so the allocator tracks
+    // its own high-water mark of the memory taken from the heap
+    struct mallinfo info = mallinfo ();
+    emscripten::val resultObj (emscripten::val::object ());
+    resultObj.set ("heapSize", (double) emscripten_get_heap_size ());
+    resultObj.set ("usedBytes", (double) info.uordblks);
+    resultObj.set ("freeBytes", (double) info.fordblks);
+    resultObj.set ("peakBytes", (double) info.usmblks);
+    return resultObj;
 }
 
 EMSCRIPTEN_BINDINGS (occtimportjs)
 {
     emscripten::function<emscripten::val, const std::string&, const emscripten::val&, const emscripten::val&> ("ReadFile", &ReadFile);
 
+#ifdef OCCTIMPORTJS_WITH_STEP
     emscripten::function<emscripten::val, const emscripten::val&, const emscripten::val&> ("ReadStepFile", &ReadStepFile);
+#endif
+#ifdef OCCTIMPORTJS_WITH_IGES
     emscripten::function<emscripten::val, const emscripten::val&, const emscripten::val&> ("ReadIgesFile", &ReadIgesFile);
+#endif
+#ifdef OCCTIMPORTJS_WITH_BREP
     emscripten::function<emscripten::val, const emscripten::val&, const emscripten::val&> ("ReadBrepFile", &ReadBrepFile);
+#endif
+
+    emscripten::function<std::string, const std::string&, const emscripten::val&, const emscripten::val&> ("GetCacheKey", &GetFileCacheKey);
+    emscripten::function<emscripten::val> ("GetMemoryInfo", &GetMemoryInfo);
+
+    emscripten::class_<ChunkedReader> ("ChunkedReader")
+        .constructor<std::string> ()
+        .function ("PushChunk", &ChunkedReader::PushChunk)
+        .function ("Finish", &ChunkedReader::Finish);
 }
 
 #endif
@@ -0,0 +1,226 @@
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#include "c-interface.hpp"
+
+class TestFile
+{
+public:
+    TestFile (const std::string& path, oij_format format) :
+        path (path),
+        format (format),
+        content ()
+    {
+
+    }
+
+    bool Load ()
+    {
+        std::ifstream inputStream (path, std::ios::binary);
+        if (!inputStream.is_open ()) {
+            return false;
+        }
+        content.assign (std::istreambuf_iterator<char> (inputStream), {});
+        return !content.empty ();
+    }
+
+    std::string path;
+    oij_format format;
+    std::vector<std::uint8_t> content;
+};
+
+class ImportSummary
+{
+public:
+    ImportSummary () :
+        success (false),
+        meshCount (0),
+        vertexCount (0),
+        triangleCount (0),
+        coordinateSum (0.0)
+    {
+
+    }
+
+    bool IsEqual (const ImportSummary& other) const
+    {
+        return success == other.success &&
+            meshCount == other.meshCount &&
+            vertexCount == other.vertexCount &&
+            triangleCount == other.triangleCount &&
+            std::fabs (coordinateSum - other.coordinateSum) <= 1e-6 * std::fabs (coordinateSum) + 1e-9;
+    }
+
+    bool success;
+    size_t meshCount;
+    size_t vertexCount;
+    size_t triangleCount;
+    double coordinateSum;
+};
+
+static std::vector<oij_import_params> GetParamsVariants ()
+{
+    // the unit conversion has global state in occt, so threads with different units must not affect each other
+    std::vector<oij_import_params> variants;
+    oij_import_params params;
+    oij_import_params_init (&params);
+    variants.push_back (params);
+
+    params.linear_unit = OIJ_LINEAR_UNIT_METER;
+    params.linear_deflection_type = OIJ_LINEAR_DEFLECTION_ABSOLUTE_VALUE;
+    params.linear_deflection = 0.0005;
+    variants.push_back (params);
+
+    oij_import_params_init (&params);
+    params.linear_unit = OIJ_LINEAR_UNIT_INCH;
+    params.linear_deflection = 0.01;
+    params.angular_deflection = 0.2;
+    variants.push_back (params);
+
+    oij_import_params_init (&params);
+    params.linear_unit = OIJ_LINEAR_UNIT_CENTIMETER;
+    params.compute_normals = 0;
+    variants.push_back (params);
+    return variants;
+}
+
+static ImportSummary ImportFile (const TestFile& file, const oij_import_params& params, bool* cacheHit = nullptr)
+{
+    ImportSummary summary;
+    oij_import* import = oij_import_create (file.format, &params);
+    if (import == nullptr) {
+        return summary;
+    }
+
+    if (oij_import_run (import, file.content.data (), file.content.size ()) == OIJ_RESULT_SUCCESS) {
+        if (cacheHit != nullptr) {
+            *cacheHit = (oij_is_cache_hit (import) != 0);
+        }
+        summary.success = true;
+        summary.meshCount = oij_get_mesh_count (import);
+        for (size_t meshIndex = 0; meshIndex < summary.meshCount; meshIndex++) {
+            oij_mesh_buffers buffers;
+            if (oij_get_mesh_buffers (import, meshIndex, &buffers) != OIJ_RESULT_SUCCESS) {
+                summary.success = false;
+                break;
+            }
+            summary.vertexCount += buffers.vertex_count;
+            summary.triangleCount += buffers.triangle_count;
+            for (size_t i = 0; i < buffers.vertex_count * 3; i++) {
+                summary.coordinateSum += buffers.positions[i];
+            }
+        }
+    }
+
+    oij_import_free (import);
+    return summary;
+}
+
+int main (int argc, const char* argv[])
+{
+    if (argc < 2) {
+        std::cout << "Usage: OcctImportJSStressTest <test files folder> [thread count] [iterations] [cache folder]" << std::endl;
+        return 1;
+    }
+
+    std::string folder = argv[1];
+    unsigned int threadCount = (argc > 2 ? std::stoi (argv[2]) : 0);
+    if (threadCount == 0) {
+        threadCount = std::max (std::thread::hardware_concurrency (), 4u);
+    }
+    int iterationCount = (argc > 3 ? std::stoi (argv[3]) : 4);
+    std::string cacheFolder = (argc > 4 ? argv[4] : std::string ());
+
+    std::vector<TestFile> files = {
+        TestFile (folder + "/cax-if/as1_pe_203.stp", OIJ_FORMAT_STEP),
+        TestFile (folder + "/rounded-cube/rounded-cube.step", OIJ_FORMAT_STEP),
+        TestFile (folder + "/cube-10x10mm/Cube 10x10.igs", OIJ_FORMAT_IGES),
+        TestFile (folder + "/cax-if-brep/as1_pe_203.brep", OIJ_FORMAT_BREP)
+    };
+
+    // the reference results are created on a single thread for every file and params variant
+    std::vector<oij_import_params> variants = GetParamsVariants ();
+    std::vector<std::vector<ImportSummary>> references;
+    for (TestFile& file : files) {
+        if (!file.Load ()) {
+            std::cout << "Failed to load " << file.path << std::endl;
+            return 1;
+        }
+        std::vector<ImportSummary> fileReferences;
+        for (const oij_import_params& params : variants) {
+            ImportSummary reference = ImportFile (file, params);
+            if (!reference.success || reference.meshCount == 0) {
+                std::cout << "Failed to import " << file.path << std::endl;
+                return 1;
+            }
+            fileReferences.push_back (reference);
+        }
+        references.push_back (fileReferences);
+    }
+
+    std::atomic<int> errorCount (0);
+    std::vector<std::thread> threads;
+    for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+        threads.push_back (std::thread ([&, threadIndex] () {
+            for (int iteration = 0; iteration < iterationCount; iteration++) {
+                // every thread starts with a different file and uses different params,
+                // so different formats and units run at the same time
+                size_t fileIndex = (threadIndex + iteration) % files.size ();
+                size_t variantIndex = (threadIndex + iteration / files.size ()) % variants.size ();
+                ImportSummary summary = ImportFile (files[fileIndex], variants[variantIndex]);
+                if (!summary.IsEqual (references[fileIndex][variantIndex])) {
+                    errorCount++;
+                }
+            }
+        }));
+    }
+    for (std::thread& thread : threads) {
+        thread.join ();
+    }
+
+    std::cout << threadCount << " threads, " << iterationCount << " iterations, " << errorCount << " errors" << std::endl;
+    if (errorCount != 0) {
+        return 1;
+    }
+
+    if (!cacheFolder.empty ()) {
+        // every thread imports every file with the same cache folder, so the same entries are
+        // written and read at the same time, the results must be the same as without the cache
+        oij_import_params cacheParams = variants[0];
+        cacheParams.cache_folder = cacheFolder.c_str ();
+        std::vector<std::thread> cacheThreads;
+        for (unsigned int threadIndex = 0; threadIndex < threadCount; threadIndex++) {
+            cacheThreads.push_back (std::thread ([&, threadIndex] () {
+                for (size_t index = 0; index < files.size (); index++) {
+                    size_t fileIndex = (threadIndex + index) % files.size ();
+                    ImportSummary summary = ImportFile (files[fileIndex], cacheParams);
+                    if (!summary.IsEqual (references[fileIndex][0])) {
+                        errorCount++;
+                    }
+                }
+            }));
+        }
+        for (std::thread& thread : cacheThreads) {
+            thread.join ();
+        }
+
+        // every entry is stored by now, so the next imports must be loaded from the cache
+        for (size_t fileIndex = 0; fileIndex < files.size (); fileIndex++) {
+            bool cacheHit = false;
+            ImportSummary summary = ImportFile (files[fileIndex], cacheParams, &cacheHit);
+            if (!cacheHit || !summary.IsEqual (references[fileIndex][0])) {
+                errorCount++;
+            }
+        }
+        std::cout << "cache in " << cacheFolder << ", " << errorCount << " errors" << std::endl;
+    }
+
+    return errorCount == 0 ? 0 : 1;
+}
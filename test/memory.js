@@ -0,0 +1,104 @@
+var fs = require ('fs');
+var path = require ('path');
+var assert = require ('assert');
+
+var occtimportjs = require ('../build/wasm/Release/occt-import-js.js');
+
+// the memory usage can grow by this ratio compared to the baseline
+var AllowedGrowthRatio = 1.1;
+// the memory that can be kept by an import, e.g. for caches that grow only once
+var AllowedRetainedBytes = 256 * 1024;
+
+// in ci the baseline must exist, otherwise the test would silently accept any value
+var isCiMode = (process.env.CI !== undefined);
+var isUpdateMode = (process.env.npm_lifecycle_event === 'test:memory:update');
+
+var baselinePath = path.join (__dirname, 'memory-baseline.json');
+// every run writes its values here, so the baseline can be taken from the build in ci
+var measurementsPath = path.join (__dirname, 'memory-measurements.json');
+var baseline = fs.existsSync (baselinePath) ? JSON.parse (fs.readFileSync (baselinePath)) : null;
+var measurements = {};
+
+var testFiles = [
+    ['step', 'simple-basic-cube/cube.stp'],
+    ['step', 'cax-if/as1_pe_203.stp'],
+    ['step', 'cax-if/as1-oc-214.stp'],
+    ['step', 'cax-if/as1-tu-203.stp'],
+    ['step', 'cax-if/dm1-id-214.stp'],
+    ['step', 'cax-if/io1-cm-214.stp'],
+    ['step', 'cax-if/sg1-c5-214.stp'],
+    ['step', 'conical-surface/conical-surface.step'],
+    ['step', 'rounded-cube/rounded-cube.step'],
+    ['iges', 'cube-10x10mm/Cube 10x10.igs'],
+    ['brep', 'cax-if-brep/as1_pe_203.brep']
+];
+
+before (function () {
+    assert (!isCiMode || isUpdateMode || baseline !== null, baselinePath + ' is missing');
+});
+
+after (function () {
+    console.table (measurements);
+    fs.writeFileSync (measurementsPath, JSON.stringify (measurements, null, 4) + '\n');
+    if (isUpdateMode || baseline === null) {
+        fs.writeFileSync (baselinePath, JSON.stringify (measurements, null, 4) + '\n');
+    }
+});
+
+function Import (occt, format, fileContent)
+{
+    let startTime = process.hrtime.bigint ();
+    let result = occt.ReadFile (format, fileContent, null);
+    let endTime = process.hrtime.bigint ();
+    assert (result.success);
+    return Number (endTime - startTime) / 1000000.0;
+}
+
+function CheckBaseline (fileName, measurement)
+{
+    if (isUpdateMode || baseline === null) {
+        return;
+    }
+    let base = baseline[fileName];
+    if (base === undefined) {
+        let message = fileName + ' is missing from the baseline, run npm run test:memory:update on a release build, or take the values from ' + measurementsPath;
+        assert (!isCiMode, message);
+        console.warn (message);
+        return;
+    }
+    for (let key of ['heapSize', 'peakBytes']) {
+        assert (measurement[key] <= base[key] * AllowedGrowthRatio, fileName + ': ' + key + ' grew from ' + base[key] + ' to ' + measurement[key]);
+    }
+}
+
+describe ('Memory', function () {
+
+for (let [format, fileName] of testFiles) {
+    it (fileName, async function () {
+        let fileContent = fs.readFileSync (path.join (__dirname, 'testfiles', fileName));
+
+        // every file is imported by a new instance of the module, so the heap size
+        // and the high-water mark don't depend on the files imported before
+        let occt = await occtimportjs ();
+
+        // the first import initializes the static data of the importer
+        Import (occt, format, fileContent);
+        let before = occt.GetMemoryInfo ();
+        let time = Import (occt, format, fileContent);
+        let after = occt.GetMemoryInfo ();
+
+        let measurement = {
+            heapSize : after.heapSize,
+            peakBytes : after.peakBytes,
+            usedBytes : after.usedBytes,
+            retainedBytes : after.usedBytes - before.usedBytes,
+            time : Math.round (time)
+        };
+        measurements[fileName] = measurement;
+
+        assert (measurement.retainedBytes <= AllowedRetainedBytes, fileName + ': ' + measurement.retainedBytes + ' bytes are not released');
+        CheckBaseline (fileName, measurement);
+    });
+}
+
+});
@@ -0,0 +1,96 @@
+var fs = require ('fs');
+var path = require ('path');
+var assert = require ('assert');
+
+var occtimportjs = require ('../build/wasm/Release/occt-import-js.js')();
+
+// cmake-js builds the addon into build/Release, other builds can give the path of the addon
+var addonPath = process.env.OCCT_NODE_ADDON || path.join (__dirname, '../build/Release/occt-import-js-node.node');
+var addon = require (addonPath);
+
+var occt = null;
+before (async function () {
+    if (occt !== null) {
+        return;
+    }
+    occt = await occtimportjs;
+});
+
+function CheckSameArray (addonArray, wasmArray)
+{
+    // the addon writes 32-bit floats, and the native math library can differ in the last bits
+    assert.strictEqual (addonArray.length, wasmArray.length);
+    for (let i = 0; i < wasmArray.length; i++) {
+        assert (Math.abs (addonArray[i] - wasmArray[i]) <= 1e-5 * Math.max (1.0, Math.abs (wasmArray[i])));
+    }
+}
+
+function CheckSameResult (addonResult, wasmResult)
+{
+    assert (addonResult.success);
+    assert (wasmResult.success);
+    assert.deepStrictEqual (addonResult.root, wasmResult.root);
+    assert.strictEqual (addonResult.meshes.length, wasmResult.meshes.length);
+    for (let meshIndex = 0; meshIndex < wasmResult.meshes.length; meshIndex++) {
+        let addonMesh = addonResult.meshes[meshIndex];
+        let wasmMesh = wasmResult.meshes[meshIndex];
+        assert.strictEqual (addonMesh.name, wasmMesh.name);
+        assert.deepStrictEqual (addonMesh.color, wasmMesh.color);
+        assert.deepStrictEqual (addonMesh.brep_faces, wasmMesh.brep_faces);
+        assert.deepStrictEqual (Array.from (addonMesh.index.array), wasmMesh.index.array);
+
+        CheckSameArray (addonMesh.attributes.position.array, wasmMesh.attributes.position.array);
+        assert.strictEqual (addonMesh.attributes.normal === undefined, wasmMesh.attributes.normal === undefined);
+        if (wasmMesh.attributes.normal !== undefined) {
+            CheckSameArray (addonMesh.attributes.normal.array, wasmMesh.attributes.normal.array);
+        }
+    }
+}
+
+describe ('Node Addon', function () {
+
+it ('Same result as wasm', async function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let addonResult = await addon.ReadStepFile (fileContent, null);
+    let wasmResult = occt.ReadStepFile (fileContent, null);
+    CheckSameResult (addonResult, wasmResult);
+});
+
+it ('Same result as wasm with params', async function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let params = { linearUnit : 'meter', linearDeflectionType : 'absolute_value', linearDeflection : 0.001 };
+    let addonResult = await addon.ReadFile ('step', fileContent, params);
+    let wasmResult = occt.ReadFile ('step', fileContent, params);
+    CheckSameResult (addonResult, wasmResult);
+});
+
+it ('Cache data is compatible with wasm', async function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let addonResult = await addon.ReadStepFile (fileContent, { cacheOutput : true });
+    let wasmResult = occt.ReadStepFile (fileContent, { cacheOutput : true });
+    assert.strictEqual (addonResult.cacheKey, wasmResult.cacheKey);
+    assert (!addonResult.cacheHit);
+
+    let cachedResult = await addon.ReadStepFile (fileContent, { cacheOutput : true, cacheData : wasmResult.cacheData });
+    assert (cachedResult.cacheHit);
+    assert.strictEqual (cachedResult.cacheData, undefined);
+    CheckSameResult (cachedResult, wasmResult);
+});
+
+it ('Reuse meshes of previous data', async function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let previousResult = await addon.ReadStepFile (fileContent, { cacheOutput : true, reuseOutput : true });
+    let result = await addon.ReadStepFile (fileContent, { previousData : previousResult.cacheData });
+    assert (result.success);
+    assert.strictEqual (result.reusedMeshes, result.meshes.length);
+});
+
+it ('Trace', async function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = await addon.ReadStepFile (fileContent, { trace : true });
+    assert (result.success);
+    let trace = JSON.parse (result.trace);
+    assert (trace.traceEvents.some ((event) => event.name === 'Import'));
+});
+
+});
@@ -1,6 +1,7 @@
 var fs = require ('fs');
 var path = require ('path');
 var assert = require ('assert');
+var zlib = require ('zlib');
 
 var occtimportjs = require ('../build/wasm/Release/occt-import-js.js')();
 
@@ -218,6 +219,14 @@ it ('cube-fcstd', function () {
     ]);
 });
 
+it ('cube-fcstd compact brep faces', function () {
+    let result = LoadStepFileWithParams ('./test/testfiles/cube-fcstd/cube.step', { compactBrepFaces : true });
+    assert (result.success);
+    assert.deepStrictEqual (result.colors, new Float64Array ([ 1, 0, 0, 0, 0, 1, 0, 0.4019778072834015, 0 ]));
+    assert.deepStrictEqual (result.meshes[0].brep_faces.offsets, new Uint32Array ([ 0, 2, 4, 6, 8, 10, 12 ]));
+    assert.deepStrictEqual (result.meshes[0].brep_faces.colors, new Uint16Array ([ 0, 65535, 65535, 1, 65535, 2 ]));
+});
+
 it ('conical-surface', function () {
     let result = LoadStepFile ('./test/testfiles/conical-surface/conical-surface.step');
     assert (result.success);
@@ -291,6 +300,16 @@ it ('as1_pe_203', function () {
 
 describe ('Deflection', function () {
 
+function GetBoundingBox (mesh) {
+    let box = [Infinity, Infinity, Infinity, -Infinity, -Infinity, -Infinity];
+    let positions = mesh.attributes.position.array;
+    for (let i = 0; i < positions.length; i++) {
+        box[i % 3] = Math.min (box[i % 3], positions[i]);
+        box[i % 3 + 3] = Math.max (box[i % 3 + 3], positions[i]);
+    }
+    return box;
+}
+
 function CheckVertexParamCount (params, vertexParamCount) {
     let result = LoadStepFileWithParams ('./test/testfiles/rounded-cube/rounded-cube.step', params);
     assert (result.success);
@@ -320,6 +339,197 @@ it ('Manual deflection with absolute value and units', function () {
 	CheckVertexParamCount ({ linearUnit : 'meter', linearDeflectionType : 'absolute_value', linearDeflection : 0.01 }, 162);
 });
 
+it ('Triangle budget', function () {
+    function GetTriangleCount (result) {
+        let triangleCount = 0;
+        for (let mesh of result.meshes) {
+            triangleCount += mesh.index.array.length / 3;
+        }
+        return triangleCount;
+    }
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let smallResult = occt.ReadStepFile (fileContent, { linearDeflectionType : 'triangle_budget', triangleBudget : 2000 });
+    let largeResult = occt.ReadStepFile (fileContent, { linearDeflectionType : 'triangle_budget', triangleBudget : 20000 });
+    assert (smallResult.success);
+    assert (largeResult.success);
+    assert.strictEqual (smallResult.meshes.length, 18);
+    assert.strictEqual (largeResult.meshes.length, 18);
+    assert (Math.abs (GetTriangleCount (smallResult) - 2000) <= 2000 * 0.1);
+    assert (Math.abs (GetTriangleCount (largeResult) - 20000) <= 20000 * 0.1);
+});
+
+it ('Triangle budget with conflicting options', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let params = { linearDeflectionType : 'triangle_budget', triangleBudget : 2000 };
+    assert (!occt.ReadStepFile (fileContent, Object.assign ({ reuseTriangulation : true }, params)).success);
+    assert (!occt.ReadStepFile (fileContent, Object.assign ({ deduplicateSolids : true }, params)).success);
+    assert (!occt.ReadStepFile (fileContent, Object.assign ({ cacheOutput : true, reuseOutput : true }, params)).success);
+});
+
+it ('Decimation', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/rounded-cube/rounded-cube.step');
+    let result = occt.ReadStepFile (fileContent, null);
+    let decimatedResult = occt.ReadStepFile (fileContent, { decimationRatio : 0.5 });
+    assert (decimatedResult.success);
+    let mesh = result.meshes[0];
+    let decimatedMesh = decimatedResult.meshes[0];
+    assert (decimatedMesh.index.array.length < mesh.index.array.length);
+    assert.strictEqual (decimatedMesh.attributes.position.array.length, decimatedMesh.attributes.normal.array.length);
+    assert.strictEqual (decimatedMesh.brep_faces.length, mesh.brep_faces.length);
+    assert.strictEqual (decimatedMesh.brep_faces[decimatedMesh.brep_faces.length - 1].last, decimatedMesh.index.array.length / 3 - 1);
+});
+
+it ('Decimation with max error only', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/rounded-cube/rounded-cube.step');
+    let result = occt.ReadStepFile (fileContent, null);
+    let smallErrorResult = occt.ReadStepFile (fileContent, { decimationMaxError : 0.001 });
+    let largeErrorResult = occt.ReadStepFile (fileContent, { decimationMaxError : 1.0 });
+    assert (smallErrorResult.success);
+    assert (largeErrorResult.success);
+    let triangleCount = result.meshes[0].index.array.length;
+    let smallErrorTriangleCount = smallErrorResult.meshes[0].index.array.length;
+    let largeErrorTriangleCount = largeErrorResult.meshes[0].index.array.length;
+    assert (largeErrorTriangleCount < triangleCount);
+    assert (largeErrorTriangleCount <= smallErrorTriangleCount);
+    assert (smallErrorTriangleCount <= triangleCount);
+});
+
+it ('Reuse triangulation', function () {
+    CheckVertexParamCount ({ reuseTriangulation : true }, 294);
+    CheckVertexParamCount ({ reuseTriangulation : true, linearDeflectionType : 'absolute_value', linearDeflection : 10 }, 162);
+});
+
+it ('Reuse stored triangulation', function () {
+    // the face is stored with a triangulation of five nodes around the center, meshing it gives only the corners
+    let fileContent = fs.readFileSync ('./test/testfiles/triangulated-brep/square.brep', 'utf8');
+    let params = { reuseTriangulation : true, linearDeflectionType : 'absolute_value', linearDeflection : 0.1 };
+
+    let result = occt.ReadBrepFile (Buffer.from (fileContent), params);
+    assert (result.success);
+    assert.strictEqual (result.meshes.length, 1);
+    assert.deepStrictEqual (Array.from (result.meshes[0].attributes.position.array), [0, 0, 0, 10, 0, 0, 10, 10, 0, 0, 10, 0, 5, 5, 0]);
+    assert.strictEqual (result.meshes[0].index.array.length, 12);
+
+    // the stored triangulation is coarser than the requested deflection, so the face is meshed again
+    let coarseContent = fileContent.replace ('5 4 1 0.001', '5 4 1 1');
+    let coarseResult = occt.ReadBrepFile (Buffer.from (coarseContent), params);
+    assert (coarseResult.success);
+    assert.strictEqual (coarseResult.meshes.length, 1);
+    assert.strictEqual (coarseResult.meshes[0].attributes.position.array.length, 12);
+    assert.strictEqual (coarseResult.meshes[0].index.array.length, 6);
+});
+
+it ('Skip normals', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/simple-basic-cube/cube.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let noNormalsResult = occt.ReadStepFile (fileContent, { computeNormals : false });
+    assert (noNormalsResult.success);
+    assert.strictEqual (noNormalsResult.meshes.length, result.meshes.length);
+    for (let meshIndex = 0; meshIndex < result.meshes.length; meshIndex++) {
+        let mesh = result.meshes[meshIndex];
+        let noNormalsMesh = noNormalsResult.meshes[meshIndex];
+        assert (mesh.attributes.normal !== undefined);
+        assert.strictEqual (noNormalsMesh.attributes.normal, undefined);
+        assert.deepStrictEqual (noNormalsMesh.attributes.position, mesh.attributes.position);
+        assert.deepStrictEqual (noNormalsMesh.index, mesh.index);
+    }
+});
+
+it ('Deduplicate solids', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if-brep/as1_pe_203.brep');
+    let result = occt.ReadBrepFile (fileContent, null);
+    let dedupResult = occt.ReadBrepFile (fileContent, { deduplicateSolids : true });
+    assert (dedupResult.success);
+    assert.strictEqual (dedupResult.meshes.length, result.meshes.length);
+    for (let meshIndex = 0; meshIndex < result.meshes.length; meshIndex++) {
+        let mesh = result.meshes[meshIndex];
+        let dedupMesh = dedupResult.meshes[meshIndex];
+        assert (dedupMesh.index.array.length > 0);
+        assert.strictEqual (dedupMesh.attributes.position.array.length, dedupMesh.attributes.normal.array.length);
+        let box = GetBoundingBox (mesh);
+        let dedupBox = GetBoundingBox (dedupMesh);
+        for (let i = 0; i < 6; i++) {
+            assert (Math.abs (box[i] - dedupBox[i]) < 0.01);
+        }
+    }
+});
+
+it ('Deduplicate solids with different curved faces', function () {
+    // the solids have the same vertices and face types, but their cylindrical sides bulge in opposite directions
+    let fileContent = fs.readFileSync ('./test/testfiles/curved-sides/curved-sides.step');
+    let result = occt.ReadStepFile (fileContent, null);
+    let dedupResult = occt.ReadStepFile (fileContent, { deduplicateSolids : true });
+    assert (dedupResult.success);
+    assert.strictEqual (result.meshes.length, 3);
+    assert.strictEqual (dedupResult.meshes.length, result.meshes.length);
+    for (let meshIndex = 0; meshIndex < result.meshes.length; meshIndex++) {
+        let box = GetBoundingBox (result.meshes[meshIndex]);
+        let dedupBox = GetBoundingBox (dedupResult.meshes[meshIndex]);
+        for (let i = 0; i < 6; i++) {
+            assert (Math.abs (box[i] - dedupBox[i]) < 0.01);
+        }
+    }
+    assert (GetBoundingBox (result.meshes[0])[0] < -2.9);
+    assert (GetBoundingBox (result.meshes[1])[0] > 19.9);
+});
+
+});
+
+describe ('Node Filter', function () {
+
+it ('Include nodes', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, { includeNodes : ['ROD_ASM'] });
+    assert (result.success);
+    assert.strictEqual (result.meshes.length, 3);
+    assert.deepStrictEqual (result.root, {
+        name : "",
+        meshes : [],
+        children : [
+            {
+                name : "AS1_PE_ASM",
+                meshes : [],
+                children : [
+                    {
+                        name : "ROD_ASM",
+                        meshes : [0, 1, 2],
+                        children : []
+                    }
+                ]
+            }
+        ]
+    });
+});
+
+it ('Exclude nodes', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, { excludeNodes : ['AS1_PE_ASM/L_BRACKET*'] });
+    assert (result.success);
+    assert.strictEqual (result.meshes.length, 4);
+    let children = result.root.children[0].children;
+    assert.deepStrictEqual (children.map ((child) => child.name), ['PLATE', 'ROD_ASM']);
+
+    let excludedResult = occt.ReadStepFile (fileContent, { excludeNodes : ['AS1_PE_ASM'] });
+    assert (!excludedResult.success);
+});
+
+it ('Hidden shapes and layers', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/simple-basic-cube/cube.stp');
+    let visibleResult = occt.ReadStepFile (fileContent, { skipHiddenShapes : true });
+    assert (visibleResult.success);
+    assert.strictEqual (visibleResult.meshes.length, 1);
+
+    let includedResult = occt.ReadStepFile (fileContent, { includeLayers : ['1'] });
+    assert.strictEqual (includedResult.meshes.length, 1);
+    assert.strictEqual (includedResult.meshes[0].index.array.length, 36);
+
+    let otherLayerResult = occt.ReadStepFile (fileContent, { includeLayers : ['2'] });
+    assert.strictEqual (otherLayerResult.meshes.length, 0);
+
+    let excludedResult = occt.ReadStepFile (fileContent, { excludeLayers : ['*'] });
+    assert.strictEqual (excludedResult.meshes.length, 0);
+});
+
 });
 
 describe ('Units', function () {
@@ -361,6 +571,516 @@ it ('Convert to other units', function () {
 
 });
 
+describe ('Output', function () {
+
+it ('Merge meshes', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let mergedResult = occt.ReadStepFile (fileContent, { mergeMeshes : true });
+    assert (mergedResult.success);
+    assert.deepStrictEqual (mergedResult.root, result.root);
+    assert.strictEqual (mergedResult.meshes.length, 18);
+    assert (mergedResult.batches.length < mergedResult.meshes.length);
+
+    for (let meshIndex = 0; meshIndex < mergedResult.meshes.length; meshIndex++) {
+        let mesh = result.meshes[meshIndex];
+        let mergedMesh = mergedResult.meshes[meshIndex];
+        assert.strictEqual (mergedMesh.attributes, undefined);
+        let batch = mergedResult.batches[mergedMesh.batch.index];
+        assert.deepStrictEqual (batch.color, mesh.color);
+        let rangeFound = false;
+        for (let i = 0; i < batch.ranges.length; i += 3) {
+            if (batch.ranges[i] === meshIndex) {
+                assert.strictEqual (batch.ranges[i + 1], mergedMesh.batch.first);
+                assert.strictEqual (batch.ranges[i + 2], mesh.index.array.length / 3);
+                rangeFound = true;
+            }
+        }
+        assert (rangeFound);
+    }
+
+    let smallBatchResult = occt.ReadStepFile (fileContent, { mergeMeshes : true, maxBatchVertices : 1000 });
+    assert (smallBatchResult.batches.length > mergedResult.batches.length);
+});
+
+it ('Shared buffer', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let sharedResult = occt.ReadStepFile (fileContent, { sharedBuffer : true });
+    assert (sharedResult.success);
+    assert (sharedResult.sharedBuffer instanceof SharedArrayBuffer);
+    assert.deepStrictEqual (sharedResult.root, result.root);
+    assert.strictEqual (sharedResult.meshes.length, result.meshes.length);
+
+    for (let meshIndex = 0; meshIndex < result.meshes.length; meshIndex++) {
+        let mesh = result.meshes[meshIndex];
+        let sharedMesh = sharedResult.meshes[meshIndex];
+        let position = sharedMesh.attributes.position;
+        let index = sharedMesh.index;
+        assert.strictEqual (position.array, undefined);
+        let positions = new Float32Array (sharedResult.sharedBuffer, position.byteOffset, position.length);
+        let indices = new Uint32Array (sharedResult.sharedBuffer, index.byteOffset, index.length);
+        assert.deepStrictEqual (positions, new Float32Array (mesh.attributes.position.array));
+        assert.deepStrictEqual (indices, new Uint32Array (mesh.index.array));
+    }
+});
+
+it ('Compact indices', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let compactResult = occt.ReadStepFile (fileContent, { compactIndices : true });
+    assert (compactResult.success);
+    assert.strictEqual (compactResult.meshes.length, result.meshes.length);
+    for (let meshIndex = 0; meshIndex < result.meshes.length; meshIndex++) {
+        let mesh = result.meshes[meshIndex];
+        let compactMesh = compactResult.meshes[meshIndex];
+        assert (compactMesh.index.array instanceof Uint16Array);
+        assert.deepStrictEqual (compactMesh.index.array, new Uint16Array (mesh.index.array));
+    }
+
+    let sharedResult = occt.ReadStepFile (fileContent, { compactIndices : true, sharedBuffer : true });
+    for (let meshIndex = 0; meshIndex < result.meshes.length; meshIndex++) {
+        let index = sharedResult.meshes[meshIndex].index;
+        assert.strictEqual (index.type, 'Uint16Array');
+        assert.strictEqual (index.byteOffset % 4, 0);
+        let indices = new Uint16Array (sharedResult.sharedBuffer, index.byteOffset, index.length);
+        assert.deepStrictEqual (indices, new Uint16Array (result.meshes[meshIndex].index.array));
+    }
+
+    let mergedResult = occt.ReadStepFile (fileContent, { compactIndices : true, mergeMeshes : true });
+    for (let batch of mergedResult.batches) {
+        assert (batch.attributes.position.array.length / 3 <= 65536);
+        assert (batch.index.array instanceof Uint16Array);
+    }
+});
+
+it ('Flat hierarchy', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let flatResult = occt.ReadStepFile (fileContent, { flatHierarchy : true });
+    assert (flatResult.success);
+    assert.strictEqual (flatResult.root, undefined);
+    assert.strictEqual (flatResult.meshes.length, result.meshes.length);
+
+    let nodes = flatResult.nodes;
+    let decoder = new TextDecoder ();
+    function CreateNode (nodeIndex) {
+        let node = {
+            name : decoder.decode (nodes.names.subarray (nodes.nameOffsets[nodeIndex], nodes.nameOffsets[nodeIndex + 1])),
+            meshes : Array.from (nodes.meshes.subarray (nodes.meshOffsets[nodeIndex], nodes.meshOffsets[nodeIndex + 1])),
+            children : []
+        };
+        for (let childIndex = nodes.firstChildren[nodeIndex]; childIndex !== -1; childIndex = nodes.nextSiblings[childIndex]) {
+            assert.strictEqual (nodes.parents[childIndex], nodeIndex);
+            node.children.push (CreateNode (childIndex));
+        }
+        return node;
+    }
+    assert.strictEqual (nodes.parents[0], -1);
+    assert.deepStrictEqual (CreateNode (0), result.root);
+});
+
+it ('Trace', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    assert.strictEqual (result.trace, undefined);
+
+    let tracedResult = occt.ReadStepFile (fileContent, { trace : true });
+    assert (tracedResult.success);
+    assert.strictEqual (tracedResult.meshes.length, result.meshes.length);
+    let trace = JSON.parse (tracedResult.trace);
+    let names = trace.traceEvents.map ((event) => event.name);
+    for (let name of ['Import', 'Transfer', 'TriangulateShape', 'ExtractResult', 'WriteResult']) {
+        assert (names.includes (name), name);
+    }
+    for (let event of trace.traceEvents) {
+        assert.strictEqual (event.ph, 'X');
+        assert (event.dur >= 0);
+    }
+});
+
+it ('Build bvh', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/simple-basic-cube/cube.stp');
+    let result = occt.ReadStepFile (fileContent, { buildBvh : true });
+    assert (result.success);
+    let mesh = result.meshes[0];
+    let positions = mesh.attributes.position.array;
+    let indices = mesh.index.array;
+    let bvh = mesh.bvh;
+    let nodeCount = bvh.nodes.length / 3;
+    assert.strictEqual (bvh.bounds.length, nodeCount * 6);
+    assert.strictEqual (bvh.triangles.length, indices.length / 3);
+    assert.deepStrictEqual (Array.from (bvh.triangles).sort ((a, b) => a - b), Array.from (bvh.triangles.keys ()));
+
+    for (let nodeIndex = 0; nodeIndex < nodeCount; nodeIndex++) {
+        if (bvh.nodes[nodeIndex * 3] !== 1) {
+            continue;
+        }
+        for (let i = bvh.nodes[nodeIndex * 3 + 1]; i <= bvh.nodes[nodeIndex * 3 + 2]; i++) {
+            let triangle = bvh.triangles[i];
+            for (let j = 0; j < 3; j++) {
+                let vertex = indices[triangle * 3 + j];
+                for (let k = 0; k < 3; k++) {
+                    let coord = positions[vertex * 3 + k];
+                    assert (coord >= bvh.bounds[nodeIndex * 6 + k]);
+                    assert (coord <= bvh.bounds[nodeIndex * 6 + 3 + k]);
+                }
+            }
+        }
+    }
+});
+
+});
+
+describe ('Compressed Input', function () {
+
+function CreateZipFile (fileName, content) {
+    // single entry zip file with a local header, a central directory and an end record
+    let name = Buffer.from (fileName);
+    let data = zlib.deflateRawSync (content);
+    let localHeader = Buffer.alloc (30);
+    localHeader.writeUInt32LE (0x04034B50, 0);
+    localHeader.writeUInt16LE (20, 4);
+    localHeader.writeUInt16LE (8, 8);
+    localHeader.writeUInt32LE (data.length, 18);
+    localHeader.writeUInt32LE (content.length, 22);
+    localHeader.writeUInt16LE (name.length, 26);
+    let centralHeader = Buffer.alloc (46);
+    centralHeader.writeUInt32LE (0x02014B50, 0);
+    centralHeader.writeUInt16LE (20, 6);
+    centralHeader.writeUInt16LE (8, 10);
+    centralHeader.writeUInt32LE (data.length, 20);
+    centralHeader.writeUInt32LE (content.length, 24);
+    centralHeader.writeUInt16LE (name.length, 28);
+    let endRecord = Buffer.alloc (22);
+    endRecord.writeUInt32LE (0x06054B50, 0);
+    endRecord.writeUInt16LE (1, 8);
+    endRecord.writeUInt16LE (1, 10);
+    endRecord.writeUInt32LE (centralHeader.length + name.length, 12);
+    endRecord.writeUInt32LE (localHeader.length + name.length + data.length, 16);
+    return Buffer.concat ([localHeader, name, data, centralHeader, name, endRecord]);
+}
+
+it ('Gzip step', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let compressedResult = occt.ReadStepFile (zlib.gzipSync (fileContent), null);
+    assert.deepStrictEqual (compressedResult, result);
+});
+
+it ('Zlib step', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let compressedResult = occt.ReadStepFile (zlib.deflateSync (fileContent), null);
+    assert.deepStrictEqual (compressedResult, result);
+});
+
+it ('Zip step', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let compressedResult = occt.ReadStepFile (CreateZipFile ('as1_pe_203.stp', fileContent), null);
+    assert.deepStrictEqual (compressedResult, result);
+});
+
+it ('Gzip brep', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if-brep/as1_pe_203.brep');
+    let result = occt.ReadBrepFile (fileContent, null);
+    let compressedResult = occt.ReadBrepFile (zlib.gzipSync (fileContent), null);
+    assert.deepStrictEqual (compressedResult, result);
+});
+
+it ('Truncated gzip brep', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if-brep/as1_pe_203.brep');
+    let compressedContent = zlib.gzipSync (fileContent);
+    let result = occt.ReadBrepFile (compressedContent.subarray (0, compressedContent.length - 100), null);
+    assert (!result.success);
+});
+
+it ('Corrupt gzip step', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let compressedContent = Buffer.from (zlib.gzipSync (fileContent));
+    let middle = Math.floor (compressedContent.length / 2);
+    for (let i = middle; i < middle + 16; i++) {
+        compressedContent[i] = compressedContent[i] ^ 0xFF;
+    }
+    let result = occt.ReadStepFile (compressedContent, null);
+    assert (!result.success);
+});
+
+});
+
+describe ('Chunked Input', function () {
+
+function ReadChunked (format, fileContent, chunkSize, params = null) {
+    let reader = new occt.ChunkedReader (format);
+    for (let offset = 0; offset < fileContent.length; offset += chunkSize) {
+        reader.PushChunk (fileContent.subarray (offset, offset + chunkSize));
+    }
+    let result = reader.Finish (params);
+    reader.delete ();
+    return result;
+}
+
+it ('Step in chunks', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, null);
+    let chunkedResult = ReadChunked ('step', fileContent, 4096);
+    assert.deepStrictEqual (chunkedResult, result);
+});
+
+it ('Brep in chunks', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if-brep/as1_pe_203.brep');
+    let result = occt.ReadBrepFile (fileContent, null);
+    let chunkedResult = ReadChunked ('brep', fileContent, 1000);
+    assert.deepStrictEqual (chunkedResult, result);
+});
+
+it ('Cache in chunks', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true });
+    let chunkedResult = ReadChunked ('step', fileContent, 1001, { cacheOutput : true });
+    assert.strictEqual (chunkedResult.cacheKey, occt.GetCacheKey ('step', fileContent, null));
+    assert.deepStrictEqual (chunkedResult, result);
+
+    let cachedResult = ReadChunked ('step', fileContent, 4096, { cacheOutput : true, cacheData : result.cacheData });
+    assert (cachedResult.cacheHit);
+    assert.deepStrictEqual (cachedResult.meshes, result.meshes);
+    assert.deepStrictEqual (cachedResult.root, result.root);
+});
+
+it ('Reuse meshes in chunks', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let previousResult = occt.ReadStepFile (fileContent, { cacheOutput : true, reuseOutput : true });
+    let chunkedResult = ReadChunked ('step', fileContent, 4096, { previousData : previousResult.cacheData });
+    assert (chunkedResult.success);
+    assert.strictEqual (chunkedResult.reusedMeshes, previousResult.meshes.length);
+});
+
+it ('Invalid format', function () {
+    let reader = new occt.ChunkedReader ('obj');
+    reader.PushChunk (new Uint8Array ([1, 2, 3]));
+    assert (!reader.Finish (null).success);
+    reader.delete ();
+});
+
+});
+
+describe ('Cache', function () {
+
+function RemoveCacheFields (result) {
+    delete result.cacheKey;
+    delete result.cacheHit;
+    delete result.cacheData;
+    return result;
+}
+
+function GetCacheChecksum (bytes) {
+    // the same hash as the Hasher class in importer-cache.cpp
+    const mask = (1n << 64n) - 1n;
+    let hash = 14695981039346656037n;
+    let addWord = function (word) {
+        hash ^= word;
+        hash = (hash * 1099511628211n) & mask;
+        hash ^= (hash >> 32n);
+    };
+    let view = new DataView (bytes.buffer, bytes.byteOffset, bytes.byteLength);
+    let wordCount = Math.floor (bytes.length / 8);
+    for (let wordIndex = 0; wordIndex < wordCount; wordIndex++) {
+        addWord (view.getBigUint64 (wordIndex * 8, true));
+    }
+    for (let byteIndex = wordCount * 8; byteIndex < bytes.length; byteIndex++) {
+        addWord (BigInt (bytes[byteIndex]));
+    }
+    addWord (BigInt (bytes.length));
+    return hash.toString (16).padStart (16, '0');
+}
+
+function RemoveLastBrepFace (cacheData) {
+    // removes the last face range of the last mesh, and signs the data again
+    let view = new DataView (cacheData.buffer, cacheData.byteOffset, cacheData.byteLength);
+    let pos = 8;
+    let skipString = function () {
+        pos += 4 + view.getUint32 (pos, true);
+    };
+    let skipArray = function (elemSize) {
+        pos += 4 + view.getUint32 (pos, true) * elemSize;
+    };
+    let skipColor = function () {
+        let hasColor = view.getUint32 (pos, true);
+        pos += 4 + (hasColor ? 24 : 0);
+    };
+    let skipNode = function () {
+        skipString ();
+        skipArray (4);
+        let childCount = view.getUint32 (pos, true);
+        pos += 4;
+        for (let i = 0; i < childCount; i++) {
+            skipNode ();
+        }
+    };
+    skipString ();
+    skipNode ();
+    let meshCount = view.getUint32 (pos, true);
+    pos += 4;
+    let faceCountPos = 0;
+    let lastFacePos = 0;
+    for (let meshIndex = 0; meshIndex < meshCount; meshIndex++) {
+        skipString ();
+        skipString ();
+        skipColor ();
+        skipArray (8);
+        skipArray (8);
+        skipArray (4);
+        faceCountPos = pos;
+        let faceCount = view.getUint32 (pos, true);
+        pos += 4;
+        for (let faceIndex = 0; faceIndex < faceCount; faceIndex++) {
+            lastFacePos = pos;
+            pos += 8;
+            skipColor ();
+        }
+    }
+
+    let content = cacheData.slice (0, lastFacePos);
+    new DataView (content.buffer).setUint32 (faceCountPos, view.getUint32 (faceCountPos, true) - 1, true);
+    return SignCacheData (content);
+}
+
+function SignCacheData (content) {
+    let checksum = Buffer.from (GetCacheChecksum (content), 'ascii');
+    let result = new Uint8Array (content.length + 4 + checksum.length);
+    result.set (content, 0);
+    new DataView (result.buffer).setUint32 (content.length, checksum.length, true);
+    result.set (checksum, content.length + 4);
+    return result;
+}
+
+it ('Cache key depends on content and params', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/simple-basic-cube/cube.stp');
+    let otherContent = fs.readFileSync ('./test/testfiles/cube-fcstd/cube.step');
+    let key = occt.GetCacheKey ('step', fileContent, null);
+    assert.strictEqual (key, occt.GetCacheKey ('step', fileContent, {}));
+    assert.notStrictEqual (key, occt.GetCacheKey ('iges', fileContent, null));
+    assert.notStrictEqual (key, occt.GetCacheKey ('step', otherContent, null));
+    assert.notStrictEqual (key, occt.GetCacheKey ('step', fileContent, { linearDeflection : 0.1 }));
+});
+
+it ('Restore result from cache data', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cube-fcstd/cube.step');
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true });
+    assert (result.success);
+    assert (!result.cacheHit);
+    assert (result.cacheData instanceof Uint8Array);
+    assert.strictEqual (result.cacheKey, occt.GetCacheKey ('step', fileContent, null));
+
+    let cachedResult = occt.ReadStepFile (fileContent, { cacheOutput : true, cacheData : result.cacheData });
+    assert (cachedResult.success);
+    assert (cachedResult.cacheHit);
+    assert.deepStrictEqual (RemoveCacheFields (cachedResult), RemoveCacheFields (result));
+});
+
+it ('Ignore cache data of other params', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/rounded-cube/rounded-cube.step');
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true });
+    let otherResult = occt.ReadStepFile (fileContent, { cacheOutput : true, cacheData : result.cacheData, linearDeflection : 0.1 });
+    assert (otherResult.success);
+    assert (!otherResult.cacheHit);
+    assert.equal (162, otherResult.meshes[0].attributes.position.array.length);
+});
+
+it ('Ignore corrupt cache data', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cube-fcstd/cube.step');
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true, reuseOutput : true });
+    let cacheData = result.cacheData;
+
+    let corruptData = [cacheData.slice (0, cacheData.length / 2), cacheData.slice (0, cacheData.length - 1), new Uint8Array (0)];
+    for (let byteIndex of [8, 40, cacheData.length / 2, cacheData.length - 1]) {
+        let flippedData = cacheData.slice ();
+        flippedData[Math.floor (byteIndex)] ^= 0x10;
+        corruptData.push (flippedData);
+    }
+    // a huge count in place of the child count of the root node
+    let hugeCountData = cacheData.slice ();
+    new DataView (hugeCountData.buffer).setUint32 (12 + result.cacheKey.length + 8, 0xFFFFFFFF, true);
+    corruptData.push (hugeCountData);
+
+    for (let data of corruptData) {
+        let cachedResult = occt.ReadStepFile (fileContent, { cacheOutput : true, cacheData : data });
+        assert (cachedResult.success);
+        assert (!cachedResult.cacheHit);
+        assert.deepStrictEqual (RemoveCacheFields (cachedResult), RemoveCacheFields (Object.assign ({}, result)));
+
+        let reusedResult = occt.ReadStepFile (fileContent, { previousData : data });
+        assert (reusedResult.success);
+        assert.strictEqual (reusedResult.reusedMeshes, 0);
+    }
+});
+
+it ('Reuse meshes of previous data', function () {
+    let fileContent = fs.readFileSync ('./test/testfiles/cax-if/as1_pe_203.stp');
+    let cacheResult = occt.ReadStepFile (fileContent, { cacheOutput : true });
+    let cacheReusedResult = occt.ReadStepFile (fileContent, { previousData : cacheResult.cacheData });
+    assert (cacheReusedResult.success);
+    assert.strictEqual (cacheReusedResult.reusedMeshes, 0);
+
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true, reuseOutput : true });
+    let reusedResult = occt.ReadStepFile (fileContent, { previousData : result.cacheData });
+    assert (reusedResult.success);
+    assert.strictEqual (reusedResult.reusedMeshes, result.meshes.length);
+    assert.deepStrictEqual (reusedResult.meshes, result.meshes);
+    assert.deepStrictEqual (reusedResult.root, result.root);
+
+    let otherResult = occt.ReadStepFile (fileContent, { previousData : result.cacheData, linearDeflection : 0.01 });
+    assert (otherResult.success);
+    assert.strictEqual (otherResult.reusedMeshes, 0);
+});
+
+
+it ('Triangulate shapes with changed topology of previous data', function () {
+    // the key of the shape matches, but the previous mesh has a different number of faces
+    let fileContent = fs.readFileSync ('./test/testfiles/cube-fcstd/cube.step');
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true, reuseOutput : true });
+    let changedData = RemoveLastBrepFace (result.cacheData);
+    let cachedResult = occt.ReadStepFile (fileContent, { cacheOutput : true, reuseOutput : true, cacheData : changedData });
+    assert (cachedResult.cacheHit);
+    assert.strictEqual (cachedResult.meshes[0].brep_faces.length, result.meshes[0].brep_faces.length - 1);
+
+    let reusedResult = occt.ReadStepFile (fileContent, { previousData : changedData });
+    assert (reusedResult.success);
+    assert.strictEqual (reusedResult.reusedMeshes, 0);
+    assert.deepStrictEqual (reusedResult.meshes, result.meshes);
+});
+
+it ('Restore deep hierarchy from cache data', function () {
+    // the hierarchy is read without recursion, so its depth is not limited
+    let fileContent = fs.readFileSync ('./test/testfiles/simple-basic-cube/cube.stp');
+    let result = occt.ReadStepFile (fileContent, { cacheOutput : true });
+    let depth = 20000;
+    let key = Buffer.from (result.cacheKey, 'ascii');
+    let content = new Uint8Array (12 + key.length + depth * 12 + 4);
+    let view = new DataView (content.buffer);
+    view.setUint32 (0, 0x434A494F, true);
+    view.setUint32 (4, 3, true);
+    view.setUint32 (8, key.length, true);
+    content.set (key, 12);
+    let pos = 12 + key.length;
+    for (let nodeIndex = 0; nodeIndex < depth; nodeIndex++) {
+        view.setUint32 (pos, 0, true);
+        view.setUint32 (pos + 4, 0, true);
+        view.setUint32 (pos + 8, nodeIndex + 1 < depth ? 1 : 0, true);
+        pos += 12;
+    }
+    view.setUint32 (pos, 0, true);
+
+    let cachedResult = occt.ReadStepFile (fileContent, { cacheOutput : true, cacheData : SignCacheData (content), flatHierarchy : true });
+    assert (cachedResult.success);
+    assert (cachedResult.cacheHit);
+    assert.strictEqual (cachedResult.meshes.length, 0);
+    assert.strictEqual (cachedResult.nodes.parents.length, depth);
+    assert.strictEqual (cachedResult.nodes.parents[depth - 1], depth - 2);
+});
+});
+
 describe ('General Import', function () {
 
 it ('Format string test', function () {
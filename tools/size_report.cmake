@@ -0,0 +1,18 @@
+# Prints the size of the built modules, usage:
+# cmake -DSIZE_REPORT_FOLDER=<output folder> -P size_report.cmake
+
+cmake_minimum_required (VERSION 3.14)
+
+file (GLOB SizeReportFiles
+	${SIZE_REPORT_FOLDER}/occt-import-js*.js
+	${SIZE_REPORT_FOLDER}/occt-import-js*.wasm
+)
+list (SORT SizeReportFiles)
+
+message ("Module sizes:")
+foreach (sizeReportFile ${SizeReportFiles})
+	file (SIZE ${sizeReportFile} fileSize)
+	math (EXPR fileSizeKb "${fileSize} / 1024")
+	get_filename_component (fileName ${sizeReportFile} NAME)
+	message ("  ${fileName}: ${fileSizeKb} KB")
+endforeach ()